@@ -17,6 +17,7 @@
 
 #include "debug_log.h"
 #include "hn_types.h"
+#include "hn_bitpack.h"
 #include "hn_data_io.h"
 #include "hn_macro_utils.h"
 #include "hn_modes.h"
@@ -24,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 
@@ -35,12 +37,27 @@
 #define DEFAULT_CODING_LEVEL 0.5
 
 #define SUPPRESS_SELF_COUPLING 1
+#define DEFAULT_LEARNING_RULE RULE_HEBB
+#define DEFAULT_SATURATION 0.01
+
+
+/* The learning rules that can be swept one pattern at a time */
+enum learning_rule {
+    RULE_HEBB,
+    RULE_STORKEY,
+    RULE_PROJECTION,
+    RULE_SATURATED      /* Hebb with integer counts clamped at saturation */
+};
+
+static const char *rule_names[] = {"hebb", "storkey", "projection",
+                                   "saturated"};
 
 
 /* Little command-line parser */
 void command_line_parser(int argc, char **argv, int *max_trials,
                          size_t *max_units, size_t *max_patterns,
-                         double *threshold, double *coding_level);
+                         double *threshold, double *coding_level,
+                         enum learning_rule *rule, double *saturation);
 
 
 int main(int argc, char **argv)
@@ -51,6 +68,8 @@ int main(int argc, char **argv)
     size_t max_patterns;    /* Maximum number of stored patterns */
     double threshold;       /* Activation function threshold */
     double coding_level;    /* Average proportion of +1s in patterns */
+    enum learning_rule rule;    /* How the weights learn each pattern */
+    double saturation;      /* Largest absolute weight (saturated rule) */
     
     /* Variables for timing */
     clock_t clock_start, clock_end; /* To time each trial */
@@ -59,10 +78,13 @@ int main(int argc, char **argv)
     /* Data structure pointers */
     spike_T **patterns = NULL;
     double **weights = NULL;
+    double *projector_diagonal = NULL;  /* (Projection rule only) */
+    hn_count_weights counts = {NULL, 0.};   /* (Saturated rule only) */
     
     /* Strings to hold customised savefile names */
     char s_filename[100];
     char s_filename_var[100];
+    char s_filename_energy[100];
     
     /* Seed if DEBUG_LOG is not toggled */
 #   ifndef DEBUG_LOG
@@ -70,7 +92,7 @@ int main(int argc, char **argv)
 #   endif
     
     command_line_parser(argc, argv, &max_trials, &max_units, &max_patterns,
-                        &threshold, &coding_level);
+                        &threshold, &coding_level, &rule, &saturation);
     
     /* Program description to the user */
     printf("\n- Hopfield Network -\nRetrieval Probability estimation "
@@ -79,8 +101,13 @@ int main(int argc, char **argv)
     printf("MC estimate over %d trials.\n"
            "Number of units: %lu\tMemorised patterns: 1 to %lu\n"
            "Activation threshold: %g\n"
-           "Coding level: %g\n\n", max_trials, max_units, max_patterns,
-           threshold, coding_level);
+           "Coding level: %g\n"
+           "Learning rule: %s\n", max_trials, max_units, max_patterns,
+           threshold, coding_level, rule_names[rule]);
+    if (rule == RULE_SATURATED) {
+        printf("Saturation: %g\n", saturation);
+    }
+    printf("\n");
     
     /*
      * For each number of patterns we build the weights with those, then perform
@@ -99,6 +126,16 @@ int main(int argc, char **argv)
     /* Estimated second moment */
     double *avg_sq_overlaps = calloc(max_patterns, sizeof (double));
     KillUnless(avg_sq_overlaps != NULL);
+    
+    /* Estimated mean energy of the attractor reached (tracked by the
+     * recall itself, at no extra matrix pass) */
+    double *avg_energies = calloc(max_patterns, sizeof (double));
+    KillUnless(avg_energies != NULL);
+    
+    /* Recalled states are compared bit-packed, one word every 64 units */
+    packed_spikes_T *final_state = malloc(hn_packed_length(max_units) *
+                                          sizeof (packed_spikes_T));
+    KillUnless(final_state != NULL);
         
     /* Main loop: identical experiments with randomised data
      * for Monte Carlo estimation of the retrieval probabilities */
@@ -120,48 +157,93 @@ int main(int argc, char **argv)
             hn_fill_rand_pattern(patterns[i], coding_level, max_units);
         }
         
-        /* Create weight matrix and set entries to 0.0 */
+        /* Create weight matrix and set entries to 0.0 (saturated
+         * synapses are integer counts, recalled as they are) */
         Logger("Creating a zero matrix for weights...\n");
-        MatrixZeros(weights, max_units, max_units);
+        if (rule == RULE_SATURATED) {
+            MatrixZeros(counts.counts, max_units, max_units);
+        } else {
+            MatrixZeros(weights, max_units, max_units);
+        }
         Logger("... done!\n");
+        if (rule == RULE_PROJECTION) {
+            projector_diagonal = calloc(max_units, sizeof (double));
+            KillUnless(projector_diagonal != NULL);
+        }
         
         /* Secondary loop: overlap frequency vs number of stored memories */
         for (size_t i = 0; i < max_patterns; ++i) {
             size_t overlaps;
             hn_network net;
+            hn_energy_trace trace = {NULL, 0, 0, 0., 0.};
             hn_mode_utils utils = hn_utils_with_mode(MODE_RANDOM);
             
             /* Select a pattern among the first i+1 to test at random
              * and make a copy to compare later */
             spike_T *rand_pattern = patterns[RandI(i + 1)];
-            spike_T *initial_state = hn_pattern_copy(rand_pattern, max_units);
+            packed_spikes_T *initial_state = hn_packed_pattern_copy(rand_pattern,
+                                                                    max_units);
             
             /* Update the weight matrix, learning the i-th pattern
              * incrementally (the 1 means diagonal is suppressed) */
             Logger("Updating weights, learning pattern %lu...\n", i);
-            hn_hebb_weights_increment_with_pattern(weights, patterns[i],
-						   max_units, SUPPRESS_SELF_COUPLING);
+            switch (rule) {
+            case RULE_STORKEY:
+                hn_storkey_weights_increment_with_pattern(weights, patterns[i],
+                                                          max_units,
+                                                          SUPPRESS_SELF_COUPLING);
+                break;
+            case RULE_PROJECTION:
+                hn_projection_weights_increment_with_pattern(weights,
+                                                             projector_diagonal,
+                                                             patterns[i],
+                                                             max_units,
+                                                             SUPPRESS_SELF_COUPLING);
+                break;
+            case RULE_SATURATED:
+                hn_saturated_counts_increment_with_pattern(&counts, patterns[i],
+                                                           saturation, max_units,
+                                                           SUPPRESS_SELF_COUPLING);
+                break;
+            case RULE_HEBB:
+            default:
+                hn_hebb_weights_increment_with_pattern(weights, patterns[i],
+						       max_units, SUPPRESS_SELF_COUPLING);
+                break;
+            }
             Logger("... done!\n");
             
             /* Build network and perform simulation on rand_pattern */
-            net = hn_network_from_params(weights, threshold, NULL);
+            net = rule == RULE_SATURATED ?
+                  hn_network_from_counts(counts, threshold, NULL) :
+                  hn_network_from_params(weights, threshold, NULL);
             Logger("Testing rand_pattern...\n");
-            hn_test_pattern(net, rand_pattern, max_units, max_units, utils);
+            hn_test_pattern_with_energy(net, rand_pattern, max_units, max_units,
+                                        utils, &trace);
             Logger("... done!\n");
             /* (At this point rand_pattern has changed to a stable state) */
             
             /* Add the overlaps to the total counter (which will later
              * be turned into an average dividing by max_trials) */
-            overlaps = hn_overlap_frequency(initial_state, rand_pattern, max_units);
+            hn_pack_pattern(final_state, rand_pattern, max_units);
+            overlaps = hn_packed_overlap_frequency(initial_state, final_state,
+                                                   max_units);
             
             avg_overlaps[i] += (double)overlaps;
             avg_sq_overlaps[i] += (double)overlaps*overlaps;
+            avg_energies[i] += trace.final_energy;
             
             free(initial_state);
         }
         Logger("Freeing patterns and weights...\n");
-        MatrixFree(weights);
+        if (rule == RULE_SATURATED) {
+            MatrixFree(counts.counts);
+        } else {
+            MatrixFree(weights);
+        }
         MatrixFree(patterns);
+        free(projector_diagonal);
+        projector_diagonal = NULL;
         Logger("... done!\n");
 
         clock_end = clock();
@@ -179,16 +261,32 @@ int main(int argc, char **argv)
     for (size_t i = 0; i < max_patterns; ++i) {
         avg_overlaps[i] /= max_trials;
         avg_sq_overlaps[i] /= max_trials;
+        avg_energies[i] /= max_trials;
         /* After this, avg_sq_overlaps[i] is really the variance! */
         avg_sq_overlaps[i] -= avg_overlaps[i] * avg_overlaps[i];
     }
     
     /* Save average overlaps on a file */
-    snprintf(s_filename, MAX_CHARS, "avg_overlaps_%d_%lu_%lu_th%g_f%1.g.bin",
-            max_trials, max_units, max_patterns, threshold, coding_level);
+    /* (Named as before for the Hebb rule, otherwise after the rule) */
+    char rule_tag[40] = "";
+    if (rule == RULE_SATURATED) {
+        snprintf(rule_tag, sizeof (rule_tag), "_%s%g", rule_names[rule],
+                 saturation);
+    } else if (rule != RULE_HEBB) {
+        snprintf(rule_tag, sizeof (rule_tag), "_%s", rule_names[rule]);
+    }
+    snprintf(s_filename, MAX_CHARS, "avg_overlaps_%d_%lu_%lu_th%g_f%1.g%s.bin",
+            max_trials, max_units, max_patterns, threshold, coding_level,
+            rule_tag);
+    
+    snprintf(s_filename_var, MAX_CHARS, "var_overlaps_%d_%lu_%lu_th%g_f%1.g%s.bin",
+            max_trials, max_units, max_patterns, threshold, coding_level,
+            rule_tag);
     
-    snprintf(s_filename_var, MAX_CHARS, "var_overlaps_%d_%lu_%lu_th%g_f%1.g.bin",
-            max_trials, max_units, max_patterns, threshold, coding_level);
+    snprintf(s_filename_energy, MAX_CHARS,
+             "avg_energies_%d_%lu_%lu_th%g_f%1.g%s.bin",
+             max_trials, max_units, max_patterns, threshold, coding_level,
+             rule_tag);
     
     size_t bytes_written;
     
@@ -202,13 +300,22 @@ int main(int argc, char **argv)
                                     &bytes_written));
     printf("done! (size: %lu bytes)\n\n", bytes_written);
     
+    printf("Saving average attractor energies on file \'%s\'... ",
+           s_filename_energy);
+    KillUnless(IOFailure != hn_save(avg_energies, s_filename_energy,
+                                    max_patterns, &bytes_written));
+    printf("done! (size: %lu bytes)\n\n", bytes_written);
+    
+    free(final_state);
+    
     exit(EXIT_SUCCESS);
 }
 
 
 void command_line_parser(int argc, char **argv, int *max_trials,
                          size_t *max_units, size_t *max_patterns,
-                         double *threshold, double *coding_level)
+                         double *threshold, double *coding_level,
+                         enum learning_rule *rule, double *saturation)
 {
     /* Set defaults */
     *max_trials = DEFAULT_MAX_TRIALS;
@@ -216,12 +323,27 @@ void command_line_parser(int argc, char **argv, int *max_trials,
     *max_patterns = DEFAULT_MAX_PATTERNS;
     *threshold = DEFAULT_THRESHOLD;
     *coding_level = DEFAULT_CODING_LEVEL;
+    *rule = DEFAULT_LEARNING_RULE;
+    *saturation = DEFAULT_SATURATION;
     
     /* Replace defaults in order if required (notice that failure
      * in strtod and strtol yields 0.0 and 0L values respectively) */
     switch (argc) {
 	/* FALLTHROUGH */
-        default: /* Ignore args beyond argv[5] */
+        default: /* Ignore args beyond argv[7] */
+        case 8:
+            *saturation = strtod(argv[7], NULL);
+        case 7:
+            for (int r = RULE_HEBB; r <= RULE_SATURATED; ++r) {
+                if (StringsAreEqual(argv[6], rule_names[r])) {
+                    *rule = (enum learning_rule)r;
+                }
+            }
+            if (!StringsAreEqual(argv[6], rule_names[*rule])) {
+                fprintf(stderr, "Unknown learning rule \'%s\' (use hebb, "
+                        "storkey, projection or saturated)\n", argv[6]);
+                exit(EXIT_FAILURE);
+            }
         case 6:
             *coding_level = strtod(argv[5], NULL);
         case 5:
@@ -29,14 +29,14 @@
 
 int main(int argc, char **argv)
 {
-    long num_updates;
+    long *num_updates = NULL;
     
     /* Data-structures */
     hn_network net;
     hn_mode_utils utils;
 
-    spike_T *pattern = NULL;
-    spike_T *pcopy = NULL;
+    spike_T **patterns = NULL;
+    spike_T **pcopies = NULL;
     double **weights = NULL;
     double *overlaps = NULL;
     
@@ -71,7 +71,10 @@ int main(int argc, char **argv)
            "Number of patterns to test (max_patterns) = %lu\n\n",
            opts->max_units, opts->max_patterns);
     
-    /* Main loop: test all patterns in sequence */
+    /* Load all the initial patterns, keeping copies for later comparison */
+    KillUnless((num_updates = malloc(opts->max_patterns * sizeof (long))) != NULL);
+    MatrixAlloc(patterns, opts->max_patterns, opts->max_units);
+    MatrixAlloc(pcopies, opts->max_patterns, opts->max_units);
     for (size_t n = 0; n < opts->max_patterns; ++n) {
         
         Logger("Pattern %lu: press key to continue\n", n);
@@ -81,34 +84,35 @@ int main(int argc, char **argv)
         
         /* Load the next (n-th) initial pattern */
         printf("Reading pattern %lu...\n", n + 1);
-        KillUnless((pattern = malloc(opts->max_units * sizeof (spike_T))) != NULL);
-        KillUnless(hn_read_next_pattern(pattern, opts->p_filename, opts->max_units) !=
-		   IOFailure);
+        KillUnless(hn_read_next_pattern(patterns[n], opts->p_filename,
+                                        opts->max_units) != IOFailure);
         printf("... done!\n");
         
-        /* Generate network structure with weights and the extracted pattern */
-        net = hn_network_from_params(weights, opts->threshold, pattern);
-        
-        /* Copy the array for later comparison */
-        pcopy = hn_pattern_copy(pattern, opts->max_units);
-        
-        /* Determine the stable pattern, using the initial pattern
-         * stored in net. A Pointer to net.activations is returned hence
-         * we don't really need to use it */ 
-        num_updates = hn_test_pattern(net, NULL, opts->max_units, warning_threshold, utils);
+        memcpy(pcopies[n], patterns[n], opts->max_units * sizeof (spike_T));
+    }
+    
+    /* Generate network structure with weights (the patterns are given
+     * to the batched recall, which shares each weight tile among them) */
+    net = hn_network_from_params(weights, opts->threshold, NULL);
+    
+    /* Determine the stable patterns (they overwrite the initial ones) */
+    hn_test_patterns_batch(net, patterns, opts->max_patterns, opts->max_units,
+                           warning_threshold, utils, num_updates);
+    
+    /* Main loop: report on all patterns in sequence */
+    for (size_t n = 0; n < opts->max_patterns; ++n) {
         
         /* Count the absolute frequency of matches between stable
          * and initial pattern */
-        overlaps[n] = hn_overlap_frequency(net.activations, pcopy, opts->max_units);
+        overlaps[n] = hn_overlap_frequency(patterns[n], pcopies[n], opts->max_units);
         
         printf("Pattern %lu: overlaps = %g; updates before convergence = %ld\n",
-	       n + 1, overlaps[n], num_updates);
-        
-        free(pcopy);
-        pcopy = NULL;
-        free(net.activations);
-        net.activations = NULL;
+	       n + 1, overlaps[n], num_updates[n]);
     }
+    
+    MatrixFree(pcopies);
+    MatrixFree(patterns);
+    free(num_updates);
 
     size_t bytes_written;
 
@@ -0,0 +1,149 @@
+/*****************************************************
+ * C FILE (main): hn_batch_test.c                    *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the batched recall of several  *
+ *           probes with the recall of each of them  *
+ *           in turn                                 *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/* An even number of patterns makes ties (zero fields) common */
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 100
+#define MAX_PROBES 64
+#define FLIP_PROBABILITY 0.2
+#define RECALL_SEED 7
+
+
+/* Recall all the probes, batched or one at a time, and count the probes
+ * whose final state or number of updates differs */
+static size_t compare_recalls(hn_network net, spike_T **probes,
+                              size_t max_probes, size_t max_units,
+                              enum hn_mode mode)
+{
+    hn_mode_utils utils = hn_utils_with_mode(mode);
+    spike_T **batch_states;
+    MatrixAlloc(batch_states, max_probes, max_units);
+    long batch_updates[MAX_PROBES];
+    size_t mismatches = 0;
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        memcpy(batch_states[k], probes[k], max_units * sizeof (spike_T));
+    }
+    srand(RECALL_SEED);
+    long total = hn_test_patterns_batch(net, batch_states, max_probes,
+                                        max_units, max_units, utils,
+                                        batch_updates);
+    
+    srand(RECALL_SEED);
+    for (size_t k = 0; k < max_probes; ++k) {
+        net.activations = hn_pattern_copy(probes[k], max_units);
+        long updates = hn_test_pattern(net, NULL, max_units, max_units, utils);
+        mismatches += updates != batch_updates[k] ||
+                      hn_overlap_frequency(net.activations, batch_states[k],
+                                           max_units) != max_units;
+        total -= updates;
+        free(net.activations);
+    }
+    
+    MatrixFree(batch_states);
+    
+    return mismatches + (total != 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t max_probes = MAX_PROBES;
+    size_t failures = 0;
+    const enum hn_mode modes[] = {MODE_SEQUENTIAL, MODE_RANDOM,
+                                  MODE_SYNCHRONOUS, MODE_WORKLIST,
+                                  MODE_GREEDY, MODE_RANDOM_PERMUTATION};
+    const char *mode_names[] = {"MODE_SEQUENTIAL", "MODE_RANDOM",
+                                "MODE_SYNCHRONOUS", "MODE_WORKLIST",
+                                "MODE_GREEDY", "MODE_RANDOM_PERMUTATION"};
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Batched vs. one-at-a-time recall\n"
+           "Number of units = %d, number of patterns = %d, "
+           "number of probes = %d\n\n", MAX_UNITS, MAX_PATTERNS, MAX_PROBES);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    /* Corrupted copies of the first stored patterns */
+    spike_T **probes;
+    MatrixAlloc(probes, max_probes, max_units);
+    for (size_t k = 0; k < max_probes; ++k) {
+        for (size_t i = 0; i < max_units; ++i) {
+            probes[k][i] = patterns[k][i];
+            if ((double)rand() / RAND_MAX < FLIP_PROBABILITY) {
+                probes[k][i] = -probes[k][i];
+            }
+        }
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    double *packed = malloc(PackedMatrixLength(max_units) * sizeof (double));
+    KillUnless(packed != NULL);
+    hn_pack_weights(packed, weights, max_units);
+    
+    hn_network networks[3];
+    const char *format_names[] = {"dense", "counts", "packed"};
+    networks[0] = hn_network_from_params(weights, 0., NULL);
+    networks[1] = hn_network_from_counts(counts, 0., NULL);
+    networks[2] = hn_network_from_packed(packed, 0., NULL);
+    
+    for (size_t f = 0; f < 3; ++f) {
+        for (size_t m = 0; m < 6; ++m) {
+            size_t mismatches = compare_recalls(networks[f], probes,
+                                                max_probes, max_units,
+                                                modes[m]);
+            printf("%-6s weights, %-23s: %s\n", format_names[f],
+                   mode_names[m], mismatches == 0 ? "identical"
+                                                     : "DIFFERENT");
+            failures += mismatches;
+        }
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    free(packed);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(probes);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,114 @@
+/*****************************************************
+ * C FILE: hn_bitpack.c                              *
+ * MODULE: Bit-packed patterns                       *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "debug_log.h"
+#include "hn_bitpack.h"
+#include "hn_macro_utils.h"
+#include "hn_types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+size_t hn_packed_length(size_t max_units)
+{
+    return (max_units + SPIKES_PER_WORD - 1) / SPIKES_PER_WORD;
+}
+
+
+void hn_pack_pattern(packed_spikes_T *packed, spike_T *pattern,
+                     size_t max_units)
+{
+    size_t max_words = hn_packed_length(max_units);
+    
+    for (size_t w = 0; w < max_words; ++w) {
+        size_t first_unit = w * SPIKES_PER_WORD;
+        size_t word_units = Min(max_units - first_unit, SPIKES_PER_WORD);
+        packed_spikes_T word = 0;
+        for (size_t b = 0; b < word_units; ++b) {
+            word |= (packed_spikes_T)(pattern[first_unit + b] > 0) << b;
+        }
+        packed[w] = word;
+    }
+}
+
+
+void hn_unpack_pattern(spike_T *pattern, packed_spikes_T *packed,
+                       size_t max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        int bit = (packed[i / SPIKES_PER_WORD] >> (i % SPIKES_PER_WORD)) & 1;
+        pattern[i] = bit ? +1 : -1;
+    }
+}
+
+
+packed_spikes_T *hn_packed_pattern_copy(spike_T *pattern, size_t max_units)
+{
+    packed_spikes_T *packed = malloc(hn_packed_length(max_units) *
+                                     sizeof (packed_spikes_T));
+    KillUnless(packed != NULL);
+    hn_pack_pattern(packed, pattern, max_units);
+    return packed;
+}
+
+
+size_t hn_packed_hamming_distance(packed_spikes_T *p1, packed_spikes_T *p2,
+                                  size_t max_units)
+{
+    size_t max_words = hn_packed_length(max_units);
+    size_t distance = 0;
+    
+    /* The padding bits are 0 in both patterns and never count */
+    for (size_t w = 0; w < max_words; ++w) {
+        distance += PopCount(p1[w] ^ p2[w]);
+    }
+    return distance;
+}
+
+
+size_t hn_packed_overlap_frequency(packed_spikes_T *p1, packed_spikes_T *p2,
+                                   size_t max_units)
+{
+    return max_units - hn_packed_hamming_distance(p1, p2, max_units);
+}
+
+
+long hn_packed_overlap(packed_spikes_T *p1, packed_spikes_T *p2,
+                       size_t max_units)
+{
+    return (long)max_units -
+           2 * (long)hn_packed_hamming_distance(p1, p2, max_units);
+}
+
+
+void hn_pack_patterns_transposed(packed_spikes_T *unit_bits,
+                                 spike_T **patterns, size_t max_patterns,
+                                 size_t max_units)
+{
+    size_t max_words = hn_packed_length(max_patterns);
+    
+    memset(unit_bits, 0, max_units * max_words * sizeof (packed_spikes_T));
+    /* Each pattern is read along its row, while the word of each unit
+     * that it fills stays in cache for the next 63 patterns */
+    for (size_t n = 0; n < max_patterns; ++n) {
+        size_t w = n / SPIKES_PER_WORD;
+        packed_spikes_T bit = (packed_spikes_T)1 << (n % SPIKES_PER_WORD);
+        for (size_t i = 0; i < max_units; ++i) {
+            if (patterns[n][i] > 0) {
+                unit_bits[i * max_words + w] |= bit;
+            }
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*****************************************************
+ * HEADER FILE: hn_bitpack.h                         *
+ * MODULE: Bit-packed patterns                       *
+ *                                                   *
+ * FUNCTION: Conversion of spike_T patterns to one   *
+ *           bit per unit, and word-parallel         *
+ *           (XOR/popcount) comparison kernels       *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_BITPACK_H
+#define HN_BITPACK_H
+
+#include "hn_types.h"
+
+#include <stdlib.h>
+
+
+
+/**
+ * Number of packed_spikes_T words needed to hold a pattern.
+ *
+ * \param max_units    the size of the network
+ *
+ * \return             the length of the packed pattern
+ */
+size_t hn_packed_length(size_t max_units);
+
+
+/**
+ * Pack a pattern into bits (+1 is a set bit, -1 a clear one);
+ * the packed array is expected to be pre-allocated with
+ * hn_packed_length(max_units) words.
+ *
+ * \param packed       the packed pattern to be filled
+ * \param pattern      the spike_T pattern
+ * \param max_units    the size of the network
+ */
+void hn_pack_pattern(packed_spikes_T *packed, spike_T *pattern,
+                     size_t max_units);
+
+
+/**
+ * Inverse of hn_pack_pattern().
+ *
+ * \param pattern      the spike_T pattern to be filled
+ * \param packed       the packed pattern
+ * \param max_units    the size of the network
+ */
+void hn_unpack_pattern(spike_T *pattern, packed_spikes_T *packed,
+                       size_t max_units);
+
+
+/**
+ * Allocate a packed copy of a pattern.
+ *
+ * \param pattern      the pattern to be copied
+ * \param max_units    the size of the network
+ *
+ * \return             a pointer to the packed copy (freed by user)
+ */
+packed_spikes_T *hn_packed_pattern_copy(spike_T *pattern, size_t max_units);
+
+
+/**
+ * Count the units where the two packed patterns differ.
+ *
+ * \param p1           first packed pattern
+ * \param p2           second packed pattern
+ * \param max_units    the size of the network (and patterns)
+ *
+ * \return             the Hamming distance between the patterns
+ */
+size_t hn_packed_hamming_distance(packed_spikes_T *p1, packed_spikes_T *p2,
+                                  size_t max_units);
+
+
+/**
+ * Count the matches between the two packed patterns
+ * (same as hn_overlap_frequency() on the unpacked ones).
+ *
+ * \param p1           first packed pattern
+ * \param p2           second packed pattern
+ * \param max_units    the size of the network (and patterns)
+ *
+ * \return             the number of matches between the patterns
+ */
+size_t hn_packed_overlap_frequency(packed_spikes_T *p1, packed_spikes_T *p2,
+                                   size_t max_units);
+
+
+/**
+ * Dot product of the two +1/-1 patterns represented by the packed ones,
+ * i.e., max_units - 2 * (Hamming distance).
+ *
+ * \param p1           first packed pattern
+ * \param p2           second packed pattern
+ * \param max_units    the size of the network (and patterns)
+ *
+ * \return             the overlap in [-max_units, max_units]
+ */
+long hn_packed_overlap(packed_spikes_T *p1, packed_spikes_T *p2,
+                       size_t max_units);
+
+
+/**
+ * Transpose a set of patterns into unit-major bitsets: word w of row i
+ * (i.e., unit_bits[i * hn_packed_length(max_patterns) + w]) holds the
+ * activations of unit i in the patterns 64w..64w+63, packed as in
+ * hn_pack_pattern() (bit n%64 set iff unit i is +1 in pattern n).
+ *
+ * \param unit_bits    the max_units * hn_packed_length(max_patterns)
+ *                     words to be filled
+ * \param patterns     the patterns
+ * \param max_patterns the number of patterns
+ * \param max_units    the size of the network (and patterns)
+ */
+void hn_pack_patterns_transposed(packed_spikes_T *unit_bits,
+                                 spike_T **patterns, size_t max_patterns,
+                                 size_t max_units);
+
+
+#endif /* HN_BITPACK_H */
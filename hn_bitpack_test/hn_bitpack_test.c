@@ -0,0 +1,115 @@
+/*****************************************************
+ * C FILE (main): hn_bitpack_test.c                  *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks the bit-packed kernels against   *
+ *           their spike_T counterparts and the      *
+ *           packed pattern I/O                      *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_bitpack.h"
+#include "../hn_macro_utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Not a multiple of 64, to exercise the padding bits */
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 8
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t max_words = hn_packed_length(max_units);
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("Testing hn_bitpack.[hc] (%d units, %zu words per pattern)\n\n",
+           MAX_UNITS, max_words);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    packed_spikes_T **packed;
+    MatrixAlloc(packed, max_patterns, max_words);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.1 * (n + 1), max_units);
+        hn_pack_pattern(packed[n], patterns[n], max_units);
+    }
+    
+    printf("Testing hn_packed_overlap_frequency() against "
+           "hn_overlap_frequency():\n");
+    for (size_t n = 0; n < max_patterns; ++n) {
+        size_t expected = hn_overlap_frequency(patterns[0], patterns[n],
+                                               max_units);
+        size_t computed = hn_packed_overlap_frequency(packed[0], packed[n],
+                                                      max_units);
+        long overlap = hn_packed_overlap(packed[0], packed[n], max_units);
+        printf("%zu/%zu (overlap %+ld) ", computed, expected, overlap);
+        failures += computed != expected;
+        failures += overlap != 2 * (long)expected - (long)max_units;
+    }
+    printf("\n\n");
+    
+    printf("Testing hn_unpack_pattern(): checking the round trip\n");
+    spike_T *unpacked = malloc(max_units * sizeof (spike_T));
+    KillUnless(unpacked != NULL);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_unpack_pattern(unpacked, packed[n], max_units);
+        size_t matches = hn_overlap_frequency(unpacked, patterns[n], max_units);
+        printf("%zu ", matches);
+        failures += matches != max_units;
+    }
+    printf("\n\n");
+    
+    printf("Testing hn_save_packed_patterns() and hn_read_packed_patterns()\n");
+    char p_filename[] = "packed_patterns.bin";
+    packed_spikes_T **read_back;
+    MatrixAlloc(read_back, max_patterns, max_words);
+    KillUnless(IOSuccess == hn_save_packed_patterns(packed, p_filename,
+                                                    max_patterns, max_units));
+    KillUnless(IOSuccess == hn_read_packed_patterns(read_back, p_filename,
+                                                    max_patterns, max_units));
+    for (size_t n = 0; n < max_patterns; ++n) {
+        size_t distance = hn_packed_hamming_distance(packed[n], read_back[n],
+                                                     max_units);
+        printf("%zu ", distance);
+        failures += distance != 0;
+    }
+    printf("\n\n");
+    
+    printf("Testing hn_read_packed_patterns() on a dirty padding bit\n");
+    packed[max_patterns - 1][max_words - 1] |=
+        (packed_spikes_T)1 << (SPIKES_PER_WORD - 1);
+    KillUnless(IOSuccess == hn_save_packed_patterns(packed, p_filename,
+                                                    max_patterns, max_units));
+    int rejected = hn_read_packed_patterns(read_back, p_filename,
+                                           max_patterns, max_units) ==
+                   IOFailure;
+    printf("%s\n\n", rejected ? "rejected" : "ACCEPTED");
+    failures += !rejected;
+    
+    printf("%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    free(unpacked);
+    MatrixFree(read_back);
+    MatrixFree(packed);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -14,7 +14,9 @@
 
 
 #include "debug_log.h"
+#include "hn_bitpack.h"
 #include "hn_data_io.h"
+#include "hn_macro_utils.h"
 #include "hn_types.h"
 
 #include <errno.h>
@@ -220,6 +222,233 @@ enum io_error_code hn_save_weights(double **weights, char *w_filename,
 }
 
 
+enum io_error_code hn_read_packed_weights(double *packed_weights,
+                                          char *w_filename, size_t max_units)
+{
+    size_t length = PackedMatrixLength(max_units);
+    
+    FILE *w_fp = fopen(w_filename, "r");
+    if (w_fp == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    /* Check whether the file holds exactly the upper triangle
+     * of a weight matrix of the specified dimension */
+    if (file_byte_length(w_fp) != sizeof (double) * length) {
+        fprintf(stderr, "%s - File dimension not matching request\n", __func__);
+        errno = 0;
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    if (fread(packed_weights, sizeof (double), length, w_fp) < length) {
+        if (!feof(w_fp)) {
+            perror(__func__);
+            errno = 0;
+        }
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    fclose(w_fp);
+    
+    Logger("hn_read_packed_weights got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
+enum io_error_code hn_save_packed_weights(double *packed_weights,
+                                          char *w_filename, size_t max_units)
+{
+    size_t length = PackedMatrixLength(max_units);
+    
+    FILE *w_fp = NULL;
+    if ((w_fp = fopen(w_filename, "w")) == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    if (fwrite(packed_weights, sizeof (double), length, w_fp) < length) {
+        perror(__func__);
+        errno = 0;
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    fclose(w_fp);
+    
+    Logger("hn_save_packed_weights got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
+/**
+ * Check the structure of CSR weights read from a file, as required by
+ * hn_sparse_weights: columns in range and strictly increasing along each
+ * row (the recalls binary-search them), and symmetric weights (the
+ * cached fields assume them).
+ *
+ * @param weights:      the sparse weights (with consistent row offsets)
+ * @param max_units:    the size of the network
+ *
+ * @return:             NULL if valid, otherwise what is wrong
+ */
+static const char *sparse_structure_error(hn_sparse_weights weights,
+                                          size_t max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t k = weights.row_starts[i]; k < weights.row_starts[i + 1];
+             ++k) {
+            if (weights.columns[k] >= max_units) {
+                return "Column out of range";
+            }
+            if (k + 1 < weights.row_starts[i + 1] &&
+                weights.columns[k] >= weights.columns[k + 1]) {
+                return "Columns not strictly increasing within a row";
+            }
+        }
+    }
+    
+    /* Entry (i, j) must be found, with the same value, as (j, i) */
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t k = weights.row_starts[i]; k < weights.row_starts[i + 1];
+             ++k) {
+            size_t j = weights.columns[k];
+            size_t low = weights.row_starts[j];
+            size_t high = weights.row_starts[j + 1];
+            while (low < high) {
+                size_t middle = low + (high - low) / 2;
+                if (weights.columns[middle] < i) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            if (low == weights.row_starts[j + 1] ||
+                weights.columns[low] != i ||
+                weights.values[low] != weights.values[k]) {
+                return "Weights not symmetric";
+            }
+        }
+    }
+    return NULL;
+}
+
+
+enum io_error_code hn_read_sparse_weights(hn_sparse_weights *weights,
+                                          char *w_filename, size_t max_units)
+{
+    FILE *w_fp = fopen(w_filename, "r");
+    if (w_fp == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    size_t *row_starts = malloc((max_units + 1) * sizeof (size_t));
+    if (row_starts == NULL) {
+        perror(__func__);
+        errno = 0;
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    /* The row offsets tell how many weights follow: check that the file
+     * holds exactly those, and that the offsets make sense */
+    long file_length = file_byte_length(w_fp);
+    if (fread(row_starts, sizeof (size_t), max_units + 1, w_fp) <
+        max_units + 1) {
+        fprintf(stderr, "%s - File too short\n", __func__);
+        errno = 0;
+        free(row_starts);
+        fclose(w_fp);
+        return IOFailure;
+    }
+    int valid_offsets = row_starts[0] == 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        valid_offsets = valid_offsets && row_starts[i] <= row_starts[i + 1];
+    }
+    size_t max_nonzeros = row_starts[max_units];
+    if (!valid_offsets || file_length != (max_units + 1) * sizeof (size_t) +
+        max_nonzeros * (sizeof (uint32_t) + sizeof (double))) {
+        fprintf(stderr, "%s - File dimension not matching request\n", __func__);
+        errno = 0;
+        free(row_starts);
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    uint32_t *columns = malloc(Max(max_nonzeros, 1) * sizeof (uint32_t));
+    double *values = malloc(Max(max_nonzeros, 1) * sizeof (double));
+    if (columns == NULL || values == NULL ||
+        fread(columns, sizeof (uint32_t), max_nonzeros, w_fp) < max_nonzeros ||
+        fread(values, sizeof (double), max_nonzeros, w_fp) < max_nonzeros) {
+        perror(__func__);
+        errno = 0;
+        free(values);
+        free(columns);
+        free(row_starts);
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    fclose(w_fp);
+    
+    hn_sparse_weights read = {values, columns, row_starts};
+    const char *structure_error = sparse_structure_error(read, max_units);
+    if (structure_error != NULL) {
+        fprintf(stderr, "%s - %s\n", __func__, structure_error);
+        free(values);
+        free(columns);
+        free(row_starts);
+        return IOFailure;
+    }
+    
+    *weights = read;
+    
+    Logger("hn_read_sparse_weights got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
+enum io_error_code hn_save_sparse_weights(hn_sparse_weights weights,
+                                          char *w_filename, size_t max_units)
+{
+    size_t max_nonzeros = weights.row_starts[max_units];
+    
+    FILE *w_fp = NULL;
+    if ((w_fp = fopen(w_filename, "w")) == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    if (fwrite(weights.row_starts, sizeof (size_t), max_units + 1, w_fp) <
+        max_units + 1 ||
+        fwrite(weights.columns, sizeof (uint32_t), max_nonzeros, w_fp) <
+        max_nonzeros ||
+        fwrite(weights.values, sizeof (double), max_nonzeros, w_fp) <
+        max_nonzeros) {
+        perror(__func__);
+        errno = 0;
+        fclose(w_fp);
+        return IOFailure;
+    }
+    
+    fclose(w_fp);
+    
+    Logger("hn_save_sparse_weights got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
 enum io_error_code hn_save_next_pattern(spike_T *pattern, char *p_filename,
 					size_t max_units)
 {
@@ -246,6 +475,89 @@ enum io_error_code hn_save_next_pattern(spike_T *pattern, char *p_filename,
 }
 
 
+enum io_error_code hn_read_packed_patterns(packed_spikes_T **packed,
+                                           char *p_filename,
+                                           size_t max_patterns,
+                                           size_t max_units)
+{
+    size_t max_words = hn_packed_length(max_units);
+    /* Units in the last word (0 if it is full) */
+    size_t last_units = max_units % SPIKES_PER_WORD;
+    
+    FILE *p_fp = fopen(p_filename, "r");
+    if (p_fp == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    /* Check whether the file holds exactly the requested patterns */
+    if (file_byte_length(p_fp) !=
+        sizeof (packed_spikes_T) * max_words * max_patterns) {
+        fprintf(stderr, "%s - File dimension not matching request\n", __func__);
+        errno = 0;
+        fclose(p_fp);
+        return IOFailure;
+    }
+    
+    for (size_t n = 0; n < max_patterns; ++n) {
+        if (fread(packed[n], sizeof (packed_spikes_T), max_words, p_fp) <
+            max_words) {
+            perror(__func__);
+            errno = 0;
+            fclose(p_fp);
+            return IOFailure;
+        }
+        /* The comparison kernels count on clear padding bits */
+        if (last_units > 0 && packed[n][max_words - 1] >> last_units != 0) {
+            fprintf(stderr, "%s - Padding bits set after the last unit\n",
+                    __func__);
+            errno = 0;
+            fclose(p_fp);
+            return IOFailure;
+        }
+    }
+    
+    fclose(p_fp);
+    
+    Logger("hn_read_packed_patterns got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
+enum io_error_code hn_save_packed_patterns(packed_spikes_T **packed,
+                                           char *p_filename,
+                                           size_t max_patterns,
+                                           size_t max_units)
+{
+    size_t max_words = hn_packed_length(max_units);
+    
+    FILE *p_fp = NULL;
+    if ((p_fp = fopen(p_filename, "w")) == NULL) {
+        perror(__func__);
+        errno = 0;
+        return IOFailure;
+    }
+    
+    for (size_t n = 0; n < max_patterns; ++n) {
+        if (fwrite(packed[n], sizeof (packed_spikes_T), max_words, p_fp) <
+            max_words) {
+            perror(__func__);
+            errno = 0;
+            fclose(p_fp);
+            return IOFailure;
+        }
+    }
+    
+    fclose(p_fp);
+    
+    Logger("hn_save_packed_patterns got to IOSuccess\n");
+    
+    return IOSuccess;
+}
+
+
 void hn_fill_rand_pattern(spike_T *pattern, double coding_level,
                           size_t max_units)
 {
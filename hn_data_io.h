@@ -110,6 +110,68 @@ enum io_error_code hn_save_weights(double **weights, char *w_filename,
 				   size_t max_units);
 
 
+/**
+ * Reads a weight matrix in packed upper-triangular storage (as written by
+ * hn_save_packed_weights) from a data-file; the user is responsible for
+ * providing a PackedMatrixLength(max_units) array.
+ *
+ * \param packed_weights  array that will hold the extracted weights
+ * \param w_filename      name of the datafile where the weights are stored
+ * \param max_units       the size of the network
+ *
+ * \return                outcome (type enum io_error_code)
+ */
+enum io_error_code hn_read_packed_weights(double *packed_weights,
+                                          char *w_filename, size_t max_units);
+
+
+/**
+ * Saves a weight matrix in packed upper-triangular storage to a newly
+ * created file (max_units * (max_units + 1) / 2 doubles, row by row).
+ *
+ * \param packed_weights  the packed weight matrix
+ * \param w_filename      name of the file to create and save to
+ * \param max_units       the size of the network
+ *
+ * \return                outcome (type enum io_error_code)
+ */
+enum io_error_code hn_save_packed_weights(double *packed_weights,
+                                          char *w_filename, size_t max_units);
+
+
+/**
+ * Reads a weight matrix in CSR format (as written by hn_save_sparse_weights)
+ * from a data-file. Unlike the other functions, the arrays are allocated
+ * here (since the number of weights is only known from the file) and are
+ * to be released with hn_sparse_weights_free(). Files whose columns are
+ * out of range or not strictly increasing along a row, or whose weights
+ * are not symmetric, are rejected.
+ *
+ * \param weights      the sparse weight matrix to be filled
+ * \param w_filename   name of the datafile where the weights are stored
+ * \param max_units    the size of the network
+ *
+ * \return             outcome (type enum io_error_code)
+ */
+enum io_error_code hn_read_sparse_weights(hn_sparse_weights *weights,
+                                          char *w_filename, size_t max_units);
+
+
+/**
+ * Saves a weight matrix in CSR format to a newly created file: the
+ * max_units + 1 row offsets (size_t), then the columns (uint32_t)
+ * and the values (double) of all the stored weights.
+ *
+ * \param weights      the sparse weight matrix
+ * \param w_filename   name of the file to create and save to
+ * \param max_units    the size of the network
+ *
+ * \return             outcome (type enum io_error_code)
+ */
+enum io_error_code hn_save_sparse_weights(hn_sparse_weights weights,
+                                          char *w_filename, size_t max_units);
+
+
 /**
  * Append a pattern to a binary file (newly created if it doesn't exist).
  *
@@ -123,6 +185,44 @@ enum io_error_code hn_save_next_pattern(spike_T *pattern, char *p_filename,
 					size_t max_units);
 
 
+/**
+ * Reads a list of bit-packed patterns (see hn_bitpack.h) from a data-file
+ * holding exactly max_patterns of them; the user is responsible for
+ * providing a max_patterns * hn_packed_length(max_units) array. Files
+ * where a padding bit (past max_units in the last word) is set are
+ * rejected, as the comparison kernels would count it.
+ *
+ * \param packed       the packed patterns to be filled
+ * \param p_filename   name of the datafile where the patterns are stored
+ * \param max_patterns the number of patterns
+ * \param max_units    the size of the network
+ *
+ * \return             outcome (type enum io_error_code)
+ */
+enum io_error_code hn_read_packed_patterns(packed_spikes_T **packed,
+                                           char *p_filename,
+                                           size_t max_patterns,
+                                           size_t max_units);
+
+
+/**
+ * Saves a list of bit-packed patterns to a newly created file
+ * (hn_packed_length(max_units) words per pattern, 1/32 of the size
+ * of the equivalent spike_T file).
+ *
+ * \param packed       the packed patterns
+ * \param p_filename   name of the file to create and save to
+ * \param max_patterns the number of patterns
+ * \param max_units    the size of the network
+ *
+ * \return             outcome (type enum io_error_code)
+ */
+enum io_error_code hn_save_packed_patterns(packed_spikes_T **packed,
+                                           char *p_filename,
+                                           size_t max_patterns,
+                                           size_t max_units);
+
+
 /**
  * Creates a max_units-long pattern of spike_T values
  * with the specified coding level (probability of +1);
@@ -0,0 +1,190 @@
+/*****************************************************
+ * C FILE (main): hn_dispatch_test.c                 *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the recall loops specialised   *
+ *           by mode with the loop that calls the    *
+ *           utilities through their pointers, and   *
+ *           times them                              *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_UNITS 500
+#define MAX_PATTERNS 40
+#define MAX_PROBES 40
+#define FLIP_PROBABILITY 0.2
+#define RECALL_SEED 7
+
+
+/* Wrappers of the standard selectors: hn_test_pattern can't recognise
+ * them, so they force the loop with indirect calls */
+static size_t pointer_sequential(hn_dynamics *dynamics, size_t max_units,
+                                 int reset)
+{
+    return sequential_select_unit(dynamics, max_units, reset);
+}
+
+static size_t pointer_random(hn_dynamics *dynamics, size_t max_units,
+                             int reset)
+{
+    return random_select_unit(dynamics, max_units, reset);
+}
+
+static size_t pointer_worklist(hn_dynamics *dynamics, size_t max_units,
+                               int reset)
+{
+    return worklist_select_unit(dynamics, max_units, reset);
+}
+
+static size_t pointer_greedy(hn_dynamics *dynamics, size_t max_units,
+                             int reset)
+{
+    return greedy_select_unit(dynamics, max_units, reset);
+}
+
+static size_t pointer_permutation(hn_dynamics *dynamics, size_t max_units,
+                                  int reset)
+{
+    return permutation_select_unit(dynamics, max_units, reset);
+}
+
+
+static hn_mode_utils pointer_utils(enum hn_mode mode)
+{
+    hn_mode_utils utils = hn_utils_with_mode(mode);
+    switch (mode) {
+    case MODE_RANDOM:
+        utils.select_unit = &pointer_random;
+        break;
+    case MODE_WORKLIST:
+        utils.select_unit = &pointer_worklist;
+        break;
+    case MODE_GREEDY:
+        utils.select_unit = &pointer_greedy;
+        break;
+    case MODE_RANDOM_PERMUTATION:
+        utils.select_unit = &pointer_permutation;
+        break;
+    default:
+        utils.select_unit = &pointer_sequential;
+        break;
+    }
+    return utils;
+}
+
+
+/* Recall all the probes with the given utilities: the final states are
+ * left in states, and the seconds taken are returned */
+static double recall_all(hn_network net, spike_T **probes, spike_T **states,
+                         long *updates, size_t max_probes, size_t max_units,
+                         hn_mode_utils utils)
+{
+    srand(RECALL_SEED);
+    clock_t clock_start = clock();
+    for (size_t k = 0; k < max_probes; ++k) {
+        memcpy(states[k], probes[k], max_units * sizeof (spike_T));
+        net.activations = states[k];
+        updates[k] = hn_test_pattern(net, NULL, max_units, max_units, utils);
+    }
+    clock_t clock_end = clock();
+    return (double)(clock_end - clock_start) / CLOCKS_PER_SEC;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t max_probes = MAX_PROBES;
+    size_t failures = 0;
+    const enum hn_mode modes[] = {MODE_SEQUENTIAL, MODE_RANDOM,
+                                  MODE_WORKLIST, MODE_GREEDY,
+                                  MODE_RANDOM_PERMUTATION};
+    const char *mode_names[] = {"MODE_SEQUENTIAL", "MODE_RANDOM",
+                                "MODE_WORKLIST", "MODE_GREEDY",
+                                "MODE_RANDOM_PERMUTATION"};
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Recall loops specialised by mode\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    spike_T **probes;
+    MatrixAlloc(probes, max_probes, max_units);
+    for (size_t k = 0; k < max_probes; ++k) {
+        for (size_t i = 0; i < max_units; ++i) {
+            probes[k][i] = patterns[k % max_patterns][i];
+            if ((double)rand() / RAND_MAX < FLIP_PROBABILITY) {
+                probes[k][i] = -probes[k][i];
+            }
+        }
+    }
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_network net = hn_network_from_params(weights, 0., NULL);
+    
+    spike_T **states[2];
+    long updates[2][MAX_PROBES];
+    MatrixAlloc(states[0], max_probes, max_units);
+    MatrixAlloc(states[1], max_probes, max_units);
+    
+    for (size_t m = 0; m < 5; ++m) {
+        hn_mode_utils utils = hn_utils_with_mode(modes[m]);
+        hn_mode_utils pointers = pointer_utils(modes[m]);
+        size_t mismatches = !hn_utils_are_standard(utils) +
+                            hn_utils_are_standard(pointers);
+        
+        double specialised_time = recall_all(net, probes, states[0],
+                                             updates[0], max_probes,
+                                             max_units, utils);
+        double pointer_time = recall_all(net, probes, states[1], updates[1],
+                                         max_probes, max_units, pointers);
+        for (size_t k = 0; k < max_probes; ++k) {
+            mismatches += updates[0][k] != updates[1][k] ||
+                          hn_overlap_frequency(states[0][k], states[1][k],
+                                               max_units) != max_units;
+        }
+        printf("%-23s %s (%.4f s specialised, %.4f s through pointers)\n",
+               mode_names[m], mismatches == 0 ? "identical" : "DIFFERENT",
+               specialised_time, pointer_time);
+        failures += mismatches;
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(states[1]);
+    MatrixFree(states[0]);
+    MatrixFree(weights);
+    MatrixFree(probes);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,179 @@
+/*****************************************************
+ * C FILE (main): hn_energy_test.c                   *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks the energy tracked along the     *
+ *           recall against the one computed from    *
+ *           scratch, and that it never increases    *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_sparse.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define MAX_UNITS 500
+#define MAX_PATTERNS 40
+#define MAX_TESTS 4
+#define MAX_ENERGIES 10000
+#define THRESHOLD 0.05
+#define CONNECTIVITY 0.5
+#define FLIP_PROBABILITY 0.2
+#define TOLERANCE 1e-9
+
+
+/* Recall a copy of the probe tracking the energy: it must start and end
+ * at the values computed from scratch, and never increase on the way */
+static size_t check_energy(hn_network net, spike_T *probe, size_t max_units,
+                           enum hn_mode mode, double *energies,
+                           const char *label)
+{
+    spike_T *state = hn_pattern_copy(probe, max_units);
+    net.activations = state;
+    double initial = hn_energy(net, max_units);
+    
+    hn_energy_trace trace = {energies, MAX_ENERGIES, 0, 0., 0.};
+    long updates = hn_test_pattern_with_energy(net, NULL, max_units,
+                                               max_units,
+                                               hn_utils_with_mode(mode),
+                                               &trace);
+    double final = hn_energy(net, max_units);
+    
+    size_t increases = 0;
+    for (size_t n = 1; n < trace.length; ++n) {
+        increases += energies[n] > energies[n - 1] + TOLERANCE;
+    }
+    int ends_agree = fabs(trace.initial_energy - initial) < TOLERANCE &&
+                     fabs(trace.final_energy - final) < TOLERANCE &&
+                     trace.length > 0 && energies[0] == trace.initial_energy &&
+                     energies[trace.length - 1] == trace.final_energy;
+    
+    printf("  %-9s updates = %6ld; energy %10.4f -> %10.4f "
+           "(from scratch: %10.4f -> %10.4f); recorded %zu; increases %zu\n",
+           label, updates, trace.initial_energy, trace.final_energy,
+           initial, final, trace.length, increases);
+    
+    free(state);
+    return !ends_agree || increases != 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    const enum hn_mode modes[] = {MODE_SEQUENTIAL, MODE_RANDOM, MODE_WORKLIST,
+                                  MODE_GREEDY, MODE_RANDOM_PERMUTATION};
+    const char *mode_names[] = {"MODE_SEQUENTIAL", "MODE_RANDOM",
+                                "MODE_WORKLIST", "MODE_GREEDY",
+                                "MODE_RANDOM_PERMUTATION"};
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Energy tracked along the recall\n"
+           "Number of units = %d, number of patterns = %d, "
+           "threshold = %g\n\n", MAX_UNITS, MAX_PATTERNS, THRESHOLD);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    double *packed = malloc(PackedMatrixLength(max_units) * sizeof (double));
+    KillUnless(packed != NULL);
+    hn_pack_weights(packed, weights, max_units);
+    hn_sparse_weights sparse = hn_sparse_weights_with_mask(max_units,
+                                                           CONNECTIVITY, 1, 1);
+    hn_hebb_sparse_weights_from_patterns(&sparse, patterns, max_patterns,
+                                         max_units);
+    
+    /* (The self-coupling enters the change of energy at each flip) */
+    double **self_weights;
+    MatrixAlloc(self_weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(self_weights, patterns, max_patterns,
+                                  max_units, 0);
+    
+    hn_network networks[5];
+    const char *format_names[] = {"dense", "counts", "packed", "sparse",
+                                  "diagonal"};
+    networks[0] = hn_network_from_params(weights, THRESHOLD, NULL);
+    networks[1] = hn_network_from_counts(counts, THRESHOLD, NULL);
+    networks[2] = hn_network_from_packed(packed, THRESHOLD, NULL);
+    networks[3] = hn_network_from_sparse(sparse, THRESHOLD, NULL);
+    networks[4] = hn_network_from_params(self_weights, THRESHOLD, NULL);
+    
+    double *energies = malloc(MAX_ENERGIES * sizeof (double));
+    KillUnless(energies != NULL);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        
+        for (size_t m = 0; m < 5; ++m) {
+            printf("Probe %zu, %s:\n", n, mode_names[m]);
+            for (size_t f = 0; f < 5; ++f) {
+                failures += check_energy(networks[f], probe, max_units,
+                                         modes[m], energies, format_names[f]);
+            }
+        }
+        free(probe);
+    }
+    
+    /* A recall that visits 2-cycles: only the ends are computed */
+    printf("Probe 0, MODE_SYNCHRONOUS:\n");
+    spike_T *probe = hn_pattern_copy(patterns[0], max_units);
+    hn_fill_rand_pattern(probe, 0.5, max_units);
+    spike_T *state = hn_pattern_copy(probe, max_units);
+    hn_network net = hn_network_from_params(weights, THRESHOLD, state);
+    hn_energy_trace trace = {energies, MAX_ENERGIES, 0, 0., 0.};
+    double initial = hn_energy(net, max_units);
+    hn_test_pattern_with_energy(net, NULL, max_units, max_units,
+                                hn_utils_with_mode(MODE_SYNCHRONOUS), &trace);
+    double final = hn_energy(net, max_units);
+    printf("  dense     energy %10.4f -> %10.4f (from scratch: %10.4f -> "
+           "%10.4f); recorded %zu\n", trace.initial_energy,
+           trace.final_energy, initial, final, trace.length);
+    failures += trace.length != 2 || trace.initial_energy != initial ||
+                trace.final_energy != final;
+    free(state);
+    free(probe);
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    free(energies);
+    hn_sparse_weights_free(sparse);
+    free(packed);
+    MatrixFree(self_weights);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,256 @@
+/*****************************************************
+ * C FILE (main): hn_glauber_test.c                  *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks the finite-temperature (Glauber) *
+ *           dynamics: acceptance probability,       *
+ *           annealing with a final quench, agreement *
+ *           of batched and single recalls, and the  *
+ *           rejection of invalid schedules          *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#define _DEFAULT_SOURCE
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_sparse.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_UNITS 500
+#define MAX_PATTERNS 25
+#define MAX_PROBES 8
+#define FLIP_PROBABILITY 0.2
+#define RECALL_SEED 7
+
+/* Uncoupled units: each one is +1 with the Glauber probability */
+#define MAX_FREE_UNITS 100000
+#define FREE_THRESHOLD 0.1
+#define FREE_TEMPERATURE 0.5
+
+/* Invalid schedules are tried on a small uncoupled network */
+#define INVALID_UNITS 10
+
+
+/* With no couplings the field is 0, so after a sweep every unit is +1
+ * with probability 1 / (1 + exp(2 threshold / T)) */
+static size_t check_acceptance(void)
+{
+    size_t max_units = MAX_FREE_UNITS;
+    hn_sparse_weights empty = hn_sparse_weights_alloc(max_units, 0);
+    memset(empty.row_starts, 0, (max_units + 1) * sizeof (size_t));
+    spike_T *state = malloc(max_units * sizeof (spike_T));
+    KillUnless(state != NULL);
+    for (size_t i = 0; i < max_units; ++i) {
+        state[i] = -1;
+    }
+    
+    hn_anneal_schedule schedule = {FREE_TEMPERATURE, 1., 1, 1, 0};
+    hn_mode_utils utils = hn_utils_with_mode(MODE_RANDOM_PERMUTATION);
+    utils.schedule = &schedule;
+    hn_test_pattern(hn_network_from_sparse(empty, FREE_THRESHOLD, state),
+                    NULL, max_units, max_units, utils);
+    
+    size_t active = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        active += state[i] == +1;
+    }
+    double frequency = (double)active / max_units;
+    double expected = 1. / (1. + exp(2. * FREE_THRESHOLD / FREE_TEMPERATURE));
+    printf("Uncoupled units: frequency of +1 = %f (expected %f)\n",
+           frequency, expected);
+    
+    free(state);
+    hn_sparse_weights_free(empty);
+    return fabs(frequency - expected) > 0.01;
+}
+
+
+/* Whether a recall with the schedule kills the process (it runs in a
+ * child, with its error message discarded) */
+static int schedule_is_rejected(hn_anneal_schedule schedule)
+{
+    /* (Or the child would print the buffered output again) */
+    fflush(stdout);
+    pid_t child = fork();
+    KillUnless(child != -1);
+    if (child == 0) {
+        KillUnless(freopen("/dev/null", "w", stderr) != NULL);
+        hn_sparse_weights empty = hn_sparse_weights_alloc(INVALID_UNITS, 0);
+        memset(empty.row_starts, 0, (INVALID_UNITS + 1) * sizeof (size_t));
+        spike_T state[INVALID_UNITS];
+        hn_fill_rand_pattern(state, 0.5, INVALID_UNITS);
+        hn_mode_utils utils = hn_utils_with_mode(MODE_RANDOM);
+        utils.schedule = &schedule;
+        /* (The field of every unit is exactly the threshold) */
+        hn_test_pattern(hn_network_from_sparse(empty, 0., state), NULL,
+                        INVALID_UNITS, INVALID_UNITS, utils);
+        hn_sparse_weights_free(empty);
+        exit(EXIT_SUCCESS);
+    }
+    int status;
+    KillUnless(waitpid(child, &status, 0) == child);
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE;
+}
+
+
+/* Schedules that start at zero or negative temperature, cool by a
+ * non-positive factor, or cool until the temperature underflows must
+ * be rejected; a valid one must not */
+static size_t check_invalid_schedules(void)
+{
+    const hn_anneal_schedule invalid[] = {
+        {0., 0.5, 2, 1, 0},         /* zero temperature */
+        {-1., 0.5, 2, 1, 0},        /* negative temperature */
+        {1., 0., 2, 1, 0},          /* zero cooling factor */
+        {1., 1e-200, 3, 1, 0},      /* underflow at the third stage */
+    };
+    const hn_anneal_schedule valid = {1., 0.5, 3, 1, 1};
+    size_t max_invalid = sizeof invalid / sizeof invalid[0];
+    size_t rejected = 0;
+    for (size_t s = 0; s < max_invalid; ++s) {
+        rejected += schedule_is_rejected(invalid[s]);
+    }
+    int valid_rejected = schedule_is_rejected(valid);
+    printf("Invalid schedules: %zu of %zu rejected (valid one %s)\n",
+           rejected, max_invalid, valid_rejected ? "REJECTED" : "accepted");
+    return (rejected != max_invalid) + valid_rejected;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t max_probes = MAX_PROBES;
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Finite-temperature (Glauber) dynamics\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    /* (Before any parallel region: the recalls run in child processes) */
+    failures += check_invalid_schedules();
+    failures += check_acceptance();
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    
+    spike_T **probes;
+    MatrixAlloc(probes, max_probes, max_units);
+    for (size_t k = 0; k < max_probes; ++k) {
+        for (size_t i = 0; i < max_units; ++i) {
+            probes[k][i] = patterns[k][i];
+            if ((double)rand() / RAND_MAX < FLIP_PROBABILITY) {
+                probes[k][i] = -probes[k][i];
+            }
+        }
+    }
+    
+    /* Annealing below the critical temperature, then quenching: the
+     * final state must be stable, and the memory retrieved */
+    hn_anneal_schedule annealing = {0.5, 0.7, 8, 2, 1};
+    /* Far above it, the state forgets the memory */
+    hn_anneal_schedule hot = {10., 1., 1, 5, 0};
+    hn_mode_utils utils = hn_utils_with_mode(MODE_RANDOM);
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        spike_T *state = hn_pattern_copy(probes[k], max_units);
+        utils.schedule = &annealing;
+        long updates = hn_test_pattern(hn_network_from_params(weights, 0.,
+                                                              state),
+                                       NULL, max_units, max_units, utils);
+        size_t unstable = unstable_units(weights, state, max_units);
+        size_t retrieved = hn_overlap_frequency(state, patterns[k], max_units);
+        
+        memcpy(state, probes[k], max_units * sizeof (spike_T));
+        utils.schedule = &hot;
+        hn_test_pattern(hn_network_from_params(weights, 0., state), NULL,
+                        max_units, max_units, utils);
+        double overlap = 2. * hn_overlap_frequency(state, patterns[k],
+                                                   max_units) / max_units - 1.;
+        
+        printf("Probe %zu: annealed in %ld updates; unstable units = %zu; "
+               "retrieved %zu/%zu; overlap at T = %g: %+.3f\n", k, updates,
+               unstable, retrieved, max_units, hot.initial_temperature,
+               overlap);
+        failures += unstable != 0 || retrieved != max_units ||
+                    fabs(overlap) > 0.25;
+        free(state);
+    }
+    
+    /* The batched recalls draw the same numbers as the single ones */
+    hn_network networks[2];
+    const char *format_names[] = {"dense", "counts"};
+    networks[0] = hn_network_from_params(weights, 0., NULL);
+    networks[1] = hn_network_from_counts(counts, 0., NULL);
+    utils.schedule = &annealing;
+    spike_T **batch_states;
+    MatrixAlloc(batch_states, max_probes, max_units);
+    long batch_updates[MAX_PROBES];
+    for (size_t f = 0; f < 2; ++f) {
+        size_t mismatches = 0;
+        memcpy(MatrixData(batch_states), MatrixData(probes),
+               max_probes * MatrixStride(probes, max_units) *
+               sizeof (spike_T));
+        srand(RECALL_SEED);
+        hn_test_patterns_batch(networks[f], batch_states, max_probes,
+                               max_units, max_units, utils, batch_updates);
+        srand(RECALL_SEED);
+        for (size_t k = 0; k < max_probes; ++k) {
+            hn_network net = networks[f];
+            net.activations = hn_pattern_copy(probes[k], max_units);
+            long updates = hn_test_pattern(net, NULL, max_units, max_units,
+                                           utils);
+            mismatches += updates != batch_updates[k] ||
+                          hn_overlap_frequency(net.activations,
+                                               batch_states[k],
+                                               max_units) != max_units;
+            free(net.activations);
+        }
+        printf("Batched vs. single annealing, %s weights: %s\n",
+               format_names[f], mismatches == 0 ? "identical" : "DIFFERENT");
+        failures += mismatches;
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(batch_states);
+    MatrixFree(probes);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
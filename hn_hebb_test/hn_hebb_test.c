@@ -0,0 +1,207 @@
+/*****************************************************
+ * C FILE (main): hn_hebb_test.c                     *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the blocked and the bitwise    *
+ *           constructions of the Hebbian weights    *
+ *           with the naive triple loop, and times   *
+ *           them                                    *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_kernels.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TIMED_UNITS 2000
+#define TIMED_PATTERNS 200
+#define LONG_ROW_UNITS 70000
+
+
+/* The original construction: weights[i][j] = sum_n x_ni x_nj / max_units */
+static void naive_hebb_weights(double **weights, spike_T **patterns,
+                               size_t max_patterns, size_t max_units,
+                               int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            weights[i][j] = 0.;
+            for (size_t n = 0; n < max_patterns; ++n) {
+                weights[i][j] += patterns[n][i] * patterns[n][j];
+            }
+            weights[i][j] /= max_units;
+        }
+        if (remove_self_coupling) {
+            weights[i][i] = 0.;
+        }
+    }
+}
+
+
+/* Build the weights of random patterns in all the ways: the blocked and
+ * bitwise versions must be exactly the same; so must the incremental
+ * versions, up to rounding (none if max_units is a power of 2) */
+static size_t check_size(size_t max_units, size_t max_patterns)
+{
+    size_t failures = 0;
+    spike_T **patterns;
+    MatrixAlloc(patterns, Max(max_patterns, 1), max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    double **expected, **weights;
+    MatrixAlloc(expected, max_units, max_units);
+    MatrixAlloc(weights, max_units, max_units);
+    hn_count_weights expected_counts, counts;
+    MatrixAlloc(expected_counts.counts, max_units, max_units);
+    MatrixAlloc(counts.counts, max_units, max_units);
+    
+    for (int self = 0; self <= 1; ++self) {
+        naive_hebb_weights(expected, patterns, max_patterns, max_units, self);
+        hn_hebb_weights_from_patterns(weights, patterns, max_patterns,
+                                      max_units, self);
+        double from_scratch = max_difference(weights, expected, max_units);
+        
+        hn_hebb_weights_from_patterns_bitwise(weights, patterns, max_patterns,
+                                              max_units, self);
+        double bitwise = max_difference(weights, expected, max_units);
+        hn_hebb_counts_from_patterns(&expected_counts, patterns, max_patterns,
+                                     max_units, self);
+        hn_hebb_counts_from_patterns_bitwise(&counts, patterns, max_patterns,
+                                             max_units, self);
+        size_t bitwise_counts = count_mismatches(counts.counts,
+                                                 expected_counts.counts,
+                                                 max_units) +
+                                (counts.scale != expected_counts.scale);
+        
+        /* Half of the patterns one by one, then the rest at once */
+        size_t first = max_patterns / 2;
+        for (size_t i = 0; i < max_units; ++i) {
+            memset(weights[i], 0, max_units * sizeof (double));
+        }
+        for (size_t n = 0; n < first; ++n) {
+            hn_hebb_weights_increment_with_pattern(weights, patterns[n],
+                                                   max_units, self);
+        }
+        hn_hebb_weights_increment_with_patterns(weights, patterns + first,
+                                                max_patterns - first,
+                                                max_units, self);
+        double incremental = max_difference(weights, expected, max_units);
+        int exact = (max_units & (max_units - 1)) == 0;
+        
+        printf("N = %4zu, P = %3zu, %s self-coupling: difference %g "
+               "(from scratch), %g (incremental), %g (bitwise); "
+               "%zu bitwise counts differ\n", max_units, max_patterns,
+               self ? "without" : "with", from_scratch, incremental, bitwise,
+               bitwise_counts);
+        failures += from_scratch != 0. || bitwise != 0. ||
+                    bitwise_counts != 0 ||
+                    incremental > (exact ? 0. : 1e-12 * max_patterns);
+    }
+    
+    MatrixFree(counts.counts);
+    MatrixFree(expected_counts.counts);
+    MatrixFree(weights);
+    MatrixFree(expected);
+    MatrixFree(patterns);
+    return failures;
+}
+
+
+/* A field of counts beyond 2^31 (all at COUNT_MAX in a row longer than
+ * 2^16) must not wrap around in the 32-bit lanes of the kernels */
+static size_t check_long_count_row(void)
+{
+    count_T *counts_row = malloc(LONG_ROW_UNITS * sizeof (count_T));
+    spike_T *activations = malloc(LONG_ROW_UNITS * sizeof (spike_T));
+    KillUnless(counts_row != NULL && activations != NULL);
+    for (size_t i = 0; i < LONG_ROW_UNITS; ++i) {
+        counts_row[i] = COUNT_MAX;
+        activations[i] = +1;
+    }
+    double expected = (double)LONG_ROW_UNITS * COUNT_MAX;
+    double local_field = hn_count_local_field(counts_row, activations,
+                                              LONG_ROW_UNITS);
+    
+    printf("\nCount field of %d units at COUNT_MAX: %.0f (expected %.0f)\n",
+           LONG_ROW_UNITS, local_field, expected);
+    free(activations);
+    free(counts_row);
+    return local_field != expected;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Blocked and bitwise Hebbian weights (%s kernels)\n\n", hn_kernels_isa());
+    
+    /* Sizes that are not multiples of the tiles, and tiny ones */
+    failures += check_size(1, 3);
+    failures += check_size(5, 0);
+    failures += check_size(37, 11);
+    failures += check_size(300, 45);
+    failures += check_size(512, 60);
+    failures += check_size(200, 130);
+    failures += check_long_count_row();
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, TIMED_PATTERNS, TIMED_UNITS);
+    for (size_t n = 0; n < TIMED_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, TIMED_UNITS);
+    }
+    double **expected, **weights;
+    MatrixAlloc(expected, TIMED_UNITS, TIMED_UNITS);
+    MatrixAlloc(weights, TIMED_UNITS, TIMED_UNITS);
+    
+    clock_t clock_start = clock();
+    naive_hebb_weights(expected, patterns, TIMED_PATTERNS, TIMED_UNITS, 1);
+    clock_t clock_middle = clock();
+    hn_hebb_weights_from_patterns(weights, patterns, TIMED_PATTERNS,
+                                  TIMED_UNITS, 1);
+    clock_t clock_end = clock();
+    double difference = max_difference(weights, expected, TIMED_UNITS);
+    hn_hebb_weights_from_patterns_bitwise(weights, patterns, TIMED_PATTERNS,
+                                          TIMED_UNITS, 1);
+    clock_t clock_bitwise = clock();
+    difference = Max(difference, max_difference(weights, expected,
+                                                 TIMED_UNITS));
+    
+    printf("\nN = %d, P = %d (CPU time of all threads): %.3f s (naive), "
+           "%.3f s (blocked), %.3f s (bitwise), difference %g\n",
+           TIMED_UNITS, TIMED_PATTERNS,
+           (double)(clock_middle - clock_start) / CLOCKS_PER_SEC,
+           (double)(clock_end - clock_middle) / CLOCKS_PER_SEC,
+           (double)(clock_bitwise - clock_end) / CLOCKS_PER_SEC, difference);
+    failures += difference != 0.;
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(weights);
+    MatrixFree(expected);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
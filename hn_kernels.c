@@ -0,0 +1,1396 @@
+/*****************************************************
+ * C FILE: hn_kernels.c                              *
+ * MODULE: Local field kernels                       *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "debug_log.h"
+#include "hn_kernels.h"
+#include "hn_macro_utils.h"
+#include "hn_types.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The vector kernels load activations as 32-bit integers */
+_Static_assert(sizeof (spike_T) == sizeof (int32_t),
+               "the kernels expect 32-bit spike_T");
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#  define HN_KERNELS_X86
+#  include <immintrin.h>
+#endif
+
+
+enum kernels_isa {ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_AVX512};
+
+static const char *isa_names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+
+/*
+ * Scalar versions (any architecture)
+ */
+
+static double field_scalar(double *weights_row, spike_T *activations,
+                           size_t max_units)
+{
+    double local_field = 0.;
+    for (size_t i = 0; i < max_units; ++i) {
+        local_field += weights_row[i] * activations[i];
+    }
+    return local_field;
+}
+
+
+static long flip_scalar(double *local_fields, double *weights_row,
+                        double delta, spike_T *activations, double threshold,
+                        size_t max_units)
+{
+    long change = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        change -= UnitIsUnstable(local_fields[i], activations[i], threshold);
+        local_fields[i] += delta * weights_row[i];
+        change += UnitIsUnstable(local_fields[i], activations[i], threshold);
+    }
+    return change;
+}
+
+
+static double count_field_scalar(count_T *counts_row, spike_T *activations,
+                                 size_t max_units)
+{
+    long local_field = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        local_field += counts_row[i] * activations[i];
+    }
+    return (double)local_field;
+}
+
+
+static long count_flip_scalar(double *local_fields, count_T *counts_row,
+                              double delta, spike_T *activations,
+                              double threshold, size_t max_units)
+{
+    long change = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        change -= UnitIsUnstable(local_fields[i], activations[i], threshold);
+        local_fields[i] += delta * counts_row[i];
+        change += UnitIsUnstable(local_fields[i], activations[i], threshold);
+    }
+    return change;
+}
+
+
+/* Tiles of the correlation matrix (see hn_correlation_update below):
+ * CORRELATION_TILE_ROWS rows by CORRELATION_PANEL columns */
+#define CORRELATION_PANEL       16
+#define CORRELATION_TILE_ROWS   4
+
+static void correlation_tile_scalar(float *tile, const float *row_panel,
+                                    const float *column_panel,
+                                    size_t max_patterns)
+{
+    float acc[CORRELATION_TILE_ROWS][CORRELATION_PANEL] = {{0.f}};
+    for (size_t n = 0; n < max_patterns; ++n) {
+        const float *row = row_panel + n * CORRELATION_PANEL;
+        const float *column = column_panel + n * CORRELATION_PANEL;
+        for (size_t r = 0; r < CORRELATION_TILE_ROWS; ++r) {
+            for (size_t c = 0; c < CORRELATION_PANEL; ++c) {
+                acc[r][c] += row[r] * column[c];
+            }
+        }
+    }
+    memcpy(tile, acc, sizeof (acc));
+}
+
+
+/* Hamming distances between a bitset and several others (of max_words
+ * words each, contiguous); see hn_bitset_correlation_update below */
+static void distances_scalar(uint32_t *distances, const packed_spikes_T *row,
+                             const packed_spikes_T *columns,
+                             size_t max_columns, size_t max_words)
+{
+    for (size_t j = 0; j < max_columns; ++j) {
+        const packed_spikes_T *column = columns + j * max_words;
+        uint32_t distance = 0;
+        for (size_t w = 0; w < max_words; ++w) {
+            distance += PopCount(row[w] ^ column[w]);
+        }
+        distances[j] = distance;
+    }
+}
+
+
+/* One row of the Storkey update (see hn_storkey_update below), which
+ * also returns the field of the row in the next pattern */
+static double storkey_row_scalar(double *row, const double *pattern,
+                                 const double *fields, const double *diagonal,
+                                 const double *next_pattern, double activation,
+                                 double field, double self_coupling,
+                                 double scale, size_t max_units)
+{
+    double next_field = 0.;
+    for (size_t j = 0; j < max_units; ++j) {
+        double weight = row[j];
+        weight += (activation * pattern[j] *
+                   (1. + (self_coupling + diagonal[j])) + 2. * weight -
+                   (activation * fields[j] + field * pattern[j])) * scale;
+        row[j] = weight;
+        next_field += weight * next_pattern[j];
+    }
+    return next_field;
+}
+
+
+/* One row of a symmetric rank-one update (see hn_rank_one_update below) */
+static void rank_one_row_scalar(double *row, const double *vector,
+                                double coefficient, double scale,
+                                size_t max_units)
+{
+    for (size_t j = 0; j < max_units; ++j) {
+        row[j] += coefficient * vector[j] * scale;
+    }
+}
+
+
+/* One row segment of the saturated counts (see hn_saturated_count_update
+ * below): the sums are exact in int, and the clamps compile to
+ * conditional moves */
+static void saturated_row_scalar(count_T *row, const count_T *pattern,
+                                 int activation, int bound, size_t max_units)
+{
+    for (size_t j = 0; j < max_units; ++j) {
+        int count = row[j] + activation * pattern[j];
+        count = count > bound ? bound : count;
+        count = count < -bound ? -bound : count;
+        row[j] = (count_T)count;
+    }
+}
+
+
+#ifdef HN_KERNELS_X86
+
+/*
+ * SSE2 versions (2 doubles per register). Since the activations are +1/-1,
+ * all products are exact and the results only depend on the order of the
+ * sums; the flip kernels give the same fields as the scalar one, as
+ * delta * weight is exact too.
+ */
+
+__attribute__((target("sse2")))
+static double field_sse2(double *weights_row, spike_T *activations,
+                         size_t max_units)
+{
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    
+    for (; i + 4 <= max_units; i += 4) {
+        __m128i spikes = _mm_loadu_si128((__m128i *)(activations + i));
+        __m128d s0 = _mm_cvtepi32_pd(spikes);
+        __m128d s1 = _mm_cvtepi32_pd(_mm_shuffle_epi32(spikes, 0x0E));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(weights_row + i), s0));
+        acc1 = _mm_add_pd(acc1,
+                          _mm_mul_pd(_mm_loadu_pd(weights_row + i + 2), s1));
+    }
+    acc0 = _mm_add_pd(acc0, acc1);
+    double local_field = _mm_cvtsd_f64(_mm_add_sd(acc0,
+                                                  _mm_unpackhi_pd(acc0, acc0)));
+    for (; i < max_units; ++i) {
+        local_field += weights_row[i] * activations[i];
+    }
+    return local_field;
+}
+
+
+__attribute__((target("sse2")))
+static long flip_sse2(double *local_fields, double *weights_row,
+                      double delta, spike_T *activations, double threshold,
+                      size_t max_units)
+{
+    __m128d deltas = _mm_set1_pd(delta);
+    __m128d thresholds = _mm_set1_pd(threshold);
+    __m128d zeros = _mm_setzero_pd();
+    long change = 0;
+    size_t i = 0;
+    
+    for (; i + 2 <= max_units; i += 2) {
+        __m128d fields = _mm_loadu_pd(local_fields + i);
+        __m128d active = _mm_cmpgt_pd(
+            _mm_cvtepi32_pd(_mm_loadl_epi64((__m128i *)(activations + i))),
+            zeros);
+        /* Unstable iff (field >= threshold) differs from (activation > 0) */
+        __m128d unstable = _mm_xor_pd(
+            _mm_cmpge_pd(_mm_sub_pd(fields, thresholds), zeros), active);
+        change -= PopCount((unsigned)_mm_movemask_pd(unstable));
+        fields = _mm_add_pd(fields,
+                            _mm_mul_pd(deltas, _mm_loadu_pd(weights_row + i)));
+        _mm_storeu_pd(local_fields + i, fields);
+        unstable = _mm_xor_pd(
+            _mm_cmpge_pd(_mm_sub_pd(fields, thresholds), zeros), active);
+        change += PopCount((unsigned)_mm_movemask_pd(unstable));
+    }
+    return change + flip_scalar(local_fields + i, weights_row + i, delta,
+                                activations + i, threshold, max_units - i);
+}
+
+
+/*
+ * AVX2 versions (4 doubles per register, fused multiply-add)
+ */
+
+__attribute__((target("avx2,fma")))
+static double field_avx2(double *weights_row, spike_T *activations,
+                         size_t max_units)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    
+    for (; i + 8 <= max_units; i += 8) {
+        __m256d s0 = _mm256_cvtepi32_pd(
+            _mm_loadu_si128((__m128i *)(activations + i)));
+        __m256d s1 = _mm256_cvtepi32_pd(
+            _mm_loadu_si128((__m128i *)(activations + i + 4)));
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(weights_row + i), s0, acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(weights_row + i + 4), s1, acc1);
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    __m128d acc = _mm_add_pd(_mm256_castpd256_pd128(acc0),
+                             _mm256_extractf128_pd(acc0, 1));
+    double local_field = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; i < max_units; ++i) {
+        local_field += weights_row[i] * activations[i];
+    }
+    return local_field;
+}
+
+
+__attribute__((target("avx2,fma,popcnt")))
+static long flip_avx2(double *local_fields, double *weights_row,
+                      double delta, spike_T *activations, double threshold,
+                      size_t max_units)
+{
+    __m256d deltas = _mm256_set1_pd(delta);
+    __m256d thresholds = _mm256_set1_pd(threshold);
+    __m256d zeros = _mm256_setzero_pd();
+    long change = 0;
+    size_t i = 0;
+    
+    for (; i + 4 <= max_units; i += 4) {
+        __m256d fields = _mm256_loadu_pd(local_fields + i);
+        __m256d active = _mm256_cmp_pd(
+            _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i *)(activations + i))),
+            zeros, _CMP_GT_OQ);
+        __m256d unstable = _mm256_xor_pd(
+            _mm256_cmp_pd(_mm256_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ),
+            active);
+        change -= PopCount((unsigned)_mm256_movemask_pd(unstable));
+        fields = _mm256_fmadd_pd(deltas, _mm256_loadu_pd(weights_row + i),
+                                 fields);
+        _mm256_storeu_pd(local_fields + i, fields);
+        unstable = _mm256_xor_pd(
+            _mm256_cmp_pd(_mm256_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ),
+            active);
+        change += PopCount((unsigned)_mm256_movemask_pd(unstable));
+    }
+    return change + flip_scalar(local_fields + i, weights_row + i, delta,
+                                activations + i, threshold, max_units - i);
+}
+
+
+/* Load 8 (resp. 4) counts and widen them to 32-bit integers */
+#ifdef HN_COUNT_INT8
+#  define LoadCounts8(p)    _mm256_cvtepi8_epi32(_mm_loadl_epi64((__m128i *)(p)))
+#  define LoadCounts4(p)    _mm_cvtepi8_epi32(_mm_cvtsi32_si128(load_int32(p)))
+#  define COUNTS_PER_VECTOR 32
+#  define SetCounts(x)      _mm256_set1_epi8(x)
+#  define SignCounts(a, b)  _mm256_sign_epi8(a, b)
+#  define AddsCounts(a, b)  _mm256_adds_epi8(a, b)
+#  define MinCounts(a, b)   _mm256_min_epi8(a, b)
+#  define MaxCounts(a, b)   _mm256_max_epi8(a, b)
+#else
+#  define LoadCounts8(p)    _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(p)))
+#  define LoadCounts4(p)    _mm_cvtepi16_epi32(_mm_loadl_epi64((__m128i *)(p)))
+#  define COUNTS_PER_VECTOR 16
+#  define SetCounts(x)      _mm256_set1_epi16(x)
+#  define SignCounts(a, b)  _mm256_sign_epi16(a, b)
+#  define AddsCounts(a, b)  _mm256_adds_epi16(a, b)
+#  define MinCounts(a, b)   _mm256_min_epi16(a, b)
+#  define MaxCounts(a, b)   _mm256_max_epi16(a, b)
+#endif
+
+static inline int32_t load_int32(void *p)
+{
+    int32_t value;
+    memcpy(&value, p, sizeof (value));
+    return value;
+}
+
+
+/* Number of 8-unit steps after which the 32-bit partial sums of
+ * count_field_avx2 are flushed: each lane then holds at most
+ * 32768 * 2^15 = 2^30 in absolute value (below 2^31), and the 8 lanes
+ * are widened to 64 bits before they are added together */
+#define COUNT_FLUSH_STEPS 32768
+
+
+__attribute__((target("avx2")))
+static double count_field_avx2(count_T *counts_row, spike_T *activations,
+                               size_t max_units)
+{
+    long local_field = 0;
+    size_t i = 0;
+    
+    while (i + 8 <= max_units) {
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t steps = 0;
+             steps < COUNT_FLUSH_STEPS && i + 8 <= max_units;
+             ++steps, i += 8) {
+            /* Negate the counts where the activation is -1 */
+            __m256i spikes = _mm256_loadu_si256((__m256i *)(activations + i));
+            acc = _mm256_add_epi32(acc,
+                                   _mm256_sign_epi32(LoadCounts8(counts_row + i),
+                                                     spikes));
+        }
+        __m256i wide = _mm256_add_epi64(
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(acc)),
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(acc, 1)));
+        __m128i sums = _mm_add_epi64(_mm256_castsi256_si128(wide),
+                                     _mm256_extracti128_si256(wide, 1));
+        sums = _mm_add_epi64(sums, _mm_unpackhi_epi64(sums, sums));
+        local_field += (long)_mm_cvtsi128_si64(sums);
+    }
+    for (; i < max_units; ++i) {
+        local_field += counts_row[i] * activations[i];
+    }
+    return (double)local_field;
+}
+
+
+__attribute__((target("avx2,fma,popcnt")))
+static long count_flip_avx2(double *local_fields, count_T *counts_row,
+                            double delta, spike_T *activations,
+                            double threshold, size_t max_units)
+{
+    __m256d deltas = _mm256_set1_pd(delta);
+    __m256d thresholds = _mm256_set1_pd(threshold);
+    __m256d zeros = _mm256_setzero_pd();
+    long change = 0;
+    size_t i = 0;
+    
+    for (; i + 4 <= max_units; i += 4) {
+        __m256d fields = _mm256_loadu_pd(local_fields + i);
+        __m256d active = _mm256_cmp_pd(
+            _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i *)(activations + i))),
+            zeros, _CMP_GT_OQ);
+        __m256d unstable = _mm256_xor_pd(
+            _mm256_cmp_pd(_mm256_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ),
+            active);
+        change -= PopCount((unsigned)_mm256_movemask_pd(unstable));
+        fields = _mm256_fmadd_pd(deltas,
+                                 _mm256_cvtepi32_pd(LoadCounts4(counts_row + i)),
+                                 fields);
+        _mm256_storeu_pd(local_fields + i, fields);
+        unstable = _mm256_xor_pd(
+            _mm256_cmp_pd(_mm256_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ),
+            active);
+        change += PopCount((unsigned)_mm256_movemask_pd(unstable));
+    }
+    return change + count_flip_scalar(local_fields + i, counts_row + i, delta,
+                                      activations + i, threshold,
+                                      max_units - i);
+}
+
+
+/* Same code with the popcnt instruction (present with AVX2) */
+__attribute__((target("popcnt")))
+static void distances_popcnt(uint32_t *distances, const packed_spikes_T *row,
+                             const packed_spikes_T *columns,
+                             size_t max_columns, size_t max_words)
+{
+    for (size_t j = 0; j < max_columns; ++j) {
+        const packed_spikes_T *column = columns + j * max_words;
+        uint32_t distance = 0;
+        for (size_t w = 0; w < max_words; ++w) {
+            distance += PopCount(row[w] ^ column[w]);
+        }
+        distances[j] = distance;
+    }
+}
+
+
+/* 8 accumulators of 8 floats: two registers per row of the tile */
+__attribute__((target("avx2,fma")))
+static void correlation_tile_avx2(float *tile, const float *row_panel,
+                                  const float *column_panel,
+                                  size_t max_patterns)
+{
+    __m256 acc00 = _mm256_setzero_ps(), acc01 = _mm256_setzero_ps();
+    __m256 acc10 = _mm256_setzero_ps(), acc11 = _mm256_setzero_ps();
+    __m256 acc20 = _mm256_setzero_ps(), acc21 = _mm256_setzero_ps();
+    __m256 acc30 = _mm256_setzero_ps(), acc31 = _mm256_setzero_ps();
+    
+    for (size_t n = 0; n < max_patterns; ++n) {
+        const float *row = row_panel + n * CORRELATION_PANEL;
+        __m256 column0 = _mm256_loadu_ps(column_panel + n * CORRELATION_PANEL);
+        __m256 column1 = _mm256_loadu_ps(column_panel + n * CORRELATION_PANEL
+                                         + 8);
+        __m256 a = _mm256_broadcast_ss(row);
+        acc00 = _mm256_fmadd_ps(a, column0, acc00);
+        acc01 = _mm256_fmadd_ps(a, column1, acc01);
+        a = _mm256_broadcast_ss(row + 1);
+        acc10 = _mm256_fmadd_ps(a, column0, acc10);
+        acc11 = _mm256_fmadd_ps(a, column1, acc11);
+        a = _mm256_broadcast_ss(row + 2);
+        acc20 = _mm256_fmadd_ps(a, column0, acc20);
+        acc21 = _mm256_fmadd_ps(a, column1, acc21);
+        a = _mm256_broadcast_ss(row + 3);
+        acc30 = _mm256_fmadd_ps(a, column0, acc30);
+        acc31 = _mm256_fmadd_ps(a, column1, acc31);
+    }
+    _mm256_storeu_ps(tile, acc00);
+    _mm256_storeu_ps(tile + 8, acc01);
+    _mm256_storeu_ps(tile + 16, acc10);
+    _mm256_storeu_ps(tile + 24, acc11);
+    _mm256_storeu_ps(tile + 32, acc20);
+    _mm256_storeu_ps(tile + 40, acc21);
+    _mm256_storeu_ps(tile + 48, acc30);
+    _mm256_storeu_ps(tile + 56, acc31);
+}
+
+
+/* The same operations as storkey_row_scalar, 4 entries at a time and
+ * without fused multiply-adds: the weights are identical (and remain
+ * exactly symmetric), only the sum of the next field is reordered */
+__attribute__((target("avx2")))
+static double storkey_row_avx2(double *row, const double *pattern,
+                               const double *fields, const double *diagonal,
+                               const double *next_pattern, double activation,
+                               double field, double self_coupling,
+                               double scale, size_t max_units)
+{
+    __m256d a = _mm256_set1_pd(activation);
+    __m256d h = _mm256_set1_pd(field);
+    __m256d d = _mm256_set1_pd(self_coupling);
+    __m256d s = _mm256_set1_pd(scale);
+    __m256d one = _mm256_set1_pd(1.);
+    __m256d two = _mm256_set1_pd(2.);
+    __m256d acc = _mm256_setzero_pd();
+    size_t j = 0;
+    
+    for (; j + 4 <= max_units; j += 4) {
+        __m256d weight = _mm256_loadu_pd(row + j);
+        __m256d x = _mm256_loadu_pd(pattern + j);
+        __m256d hebb = _mm256_mul_pd(
+            _mm256_mul_pd(a, x),
+            _mm256_add_pd(one, _mm256_add_pd(d, _mm256_loadu_pd(diagonal + j))));
+        __m256d cross = _mm256_add_pd(
+            _mm256_mul_pd(a, _mm256_loadu_pd(fields + j)),
+            _mm256_mul_pd(h, x));
+        __m256d increment = _mm256_sub_pd(
+            _mm256_add_pd(hebb, _mm256_mul_pd(two, weight)), cross);
+        weight = _mm256_add_pd(weight, _mm256_mul_pd(increment, s));
+        _mm256_storeu_pd(row + j, weight);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(weight,
+                                               _mm256_loadu_pd(next_pattern + j)));
+    }
+    __m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc),
+                              _mm256_extractf128_pd(acc, 1));
+    double next_field = _mm_cvtsd_f64(_mm_add_sd(acc2,
+                                                 _mm_unpackhi_pd(acc2, acc2)));
+    return next_field + storkey_row_scalar(row + j, pattern + j, fields + j,
+                                           diagonal + j, next_pattern + j,
+                                           activation, field, self_coupling,
+                                           scale, max_units - j);
+}
+
+
+/* The same operations as rank_one_row_scalar, 4 entries at a time (no
+ * fused multiply-adds, so that the results are identical) */
+__attribute__((target("avx2")))
+static void rank_one_row_avx2(double *row, const double *vector,
+                              double coefficient, double scale,
+                              size_t max_units)
+{
+    __m256d c = _mm256_set1_pd(coefficient);
+    __m256d s = _mm256_set1_pd(scale);
+    size_t j = 0;
+    
+    for (; j + 4 <= max_units; j += 4) {
+        __m256d increment = _mm256_mul_pd(
+            _mm256_mul_pd(c, _mm256_loadu_pd(vector + j)), s);
+        _mm256_storeu_pd(row + j, _mm256_add_pd(_mm256_loadu_pd(row + j),
+                                                increment));
+    }
+    rank_one_row_scalar(row + j, vector + j, coefficient, scale,
+                        max_units - j);
+}
+
+
+/* COUNTS_PER_VECTOR counts at a time: the sign of the activation is
+ * applied with a sign instruction and the sum saturates at COUNT_MAX
+ * before the clamps, so nothing can wrap around */
+__attribute__((target("avx2")))
+static void saturated_row_avx2(count_T *row, const count_T *pattern,
+                               int activation, int bound, size_t max_units)
+{
+    __m256i signs = SetCounts(activation);
+    __m256i upper = SetCounts(bound);
+    __m256i lower = SetCounts(-bound);
+    size_t j = 0;
+    
+    for (; j + COUNTS_PER_VECTOR <= max_units; j += COUNTS_PER_VECTOR) {
+        __m256i counts = _mm256_loadu_si256((__m256i *)(row + j));
+        __m256i increments = SignCounts(
+            _mm256_loadu_si256((__m256i *)(pattern + j)), signs);
+        counts = MinCounts(MaxCounts(AddsCounts(counts, increments), lower),
+                           upper);
+        _mm256_storeu_si256((__m256i *)(row + j), counts);
+    }
+    saturated_row_scalar(row + j, pattern + j, activation, bound,
+                         max_units - j);
+}
+
+
+/*
+ * AVX-512 versions (8 doubles per register, mask registers)
+ */
+
+__attribute__((target("avx512f")))
+static double field_avx512(double *weights_row, spike_T *activations,
+                           size_t max_units)
+{
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    
+    for (; i + 16 <= max_units; i += 16) {
+        __m512d s0 = _mm512_cvtepi32_pd(
+            _mm256_loadu_si256((__m256i *)(activations + i)));
+        __m512d s1 = _mm512_cvtepi32_pd(
+            _mm256_loadu_si256((__m256i *)(activations + i + 8)));
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(weights_row + i), s0, acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(weights_row + i + 8), s1, acc1);
+    }
+    double local_field = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; i < max_units; ++i) {
+        local_field += weights_row[i] * activations[i];
+    }
+    return local_field;
+}
+
+
+__attribute__((target("avx512f,popcnt")))
+static long flip_avx512(double *local_fields, double *weights_row,
+                        double delta, spike_T *activations, double threshold,
+                        size_t max_units)
+{
+    __m512d deltas = _mm512_set1_pd(delta);
+    __m512d thresholds = _mm512_set1_pd(threshold);
+    __m512d zeros = _mm512_setzero_pd();
+    long change = 0;
+    size_t i = 0;
+    
+    for (; i + 8 <= max_units; i += 8) {
+        __m512d fields = _mm512_loadu_pd(local_fields + i);
+        __mmask8 active = _mm512_cmp_pd_mask(
+            _mm512_cvtepi32_pd(_mm256_loadu_si256((__m256i *)(activations + i))),
+            zeros, _CMP_GT_OQ);
+        __mmask8 unstable = active ^ _mm512_cmp_pd_mask(
+            _mm512_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ);
+        change -= PopCount((unsigned)unstable);
+        fields = _mm512_fmadd_pd(deltas, _mm512_loadu_pd(weights_row + i),
+                                 fields);
+        _mm512_storeu_pd(local_fields + i, fields);
+        unstable = active ^ _mm512_cmp_pd_mask(
+            _mm512_sub_pd(fields, thresholds), zeros, _CMP_GE_OQ);
+        change += PopCount((unsigned)unstable);
+    }
+    return change + flip_scalar(local_fields + i, weights_row + i, delta,
+                                activations + i, threshold, max_units - i);
+}
+
+#endif /* HN_KERNELS_X86 */
+
+
+/*
+ * Run-time dispatch: the function pointers start at resolvers that
+ * select the kernels on the first call, then forward the call to them.
+ * The pointers are only read and written atomically, so threads may
+ * make their first calls concurrently: each of them either finds a
+ * resolver or a selected kernel, and all of them select the same ones.
+ */
+
+#define Kernel(pointer)     __atomic_load_n(&(pointer), __ATOMIC_RELAXED)
+#define SetKernel(pointer, kernel)                                          \
+    __atomic_store_n(&(pointer), (kernel), __ATOMIC_RELAXED)
+
+static double field_resolve(double *weights_row, spike_T *activations,
+                            size_t max_units);
+
+static long flip_resolve(double *local_fields, double *weights_row,
+                         double delta, spike_T *activations, double threshold,
+                         size_t max_units);
+
+static double count_field_resolve(count_T *counts_row, spike_T *activations,
+                                  size_t max_units);
+
+static long count_flip_resolve(double *local_fields, count_T *counts_row,
+                               double delta, spike_T *activations,
+                               double threshold, size_t max_units);
+
+static double (*field_kernel)(double *, spike_T *, size_t) = &field_resolve;
+
+static long (*flip_kernel)(double *, double *, double, spike_T *, double,
+                           size_t) = &flip_resolve;
+
+static double (*count_field_kernel)(count_T *, spike_T *, size_t) =
+    &count_field_resolve;
+
+static long (*count_flip_kernel)(double *, count_T *, double, spike_T *,
+                                 double, size_t) = &count_flip_resolve;
+
+static void (*correlation_kernel)(float *, const float *, const float *,
+                                  size_t) = &correlation_tile_scalar;
+
+static void (*distances_kernel)(uint32_t *, const packed_spikes_T *,
+                                const packed_spikes_T *, size_t, size_t) =
+    &distances_scalar;
+
+static double (*storkey_kernel)(double *, const double *, const double *,
+                                const double *, const double *, double,
+                                double, double, double, size_t) =
+    &storkey_row_scalar;
+
+static void (*rank_one_kernel)(double *, const double *, double, double,
+                               size_t) = &rank_one_row_scalar;
+
+static void (*saturated_kernel)(count_T *, const count_T *, int, int,
+                                size_t) = &saturated_row_scalar;
+
+static enum kernels_isa kernels_in_use = ISA_SCALAR;
+
+/* Set (with release semantics) once all the pointers above are */
+static int kernels_selected = 0;
+
+
+/* The best instruction set supported by the CPU,
+ * possibly capped by the HN_KERNELS environment variable */
+static enum kernels_isa detect_isa(void)
+{
+    enum kernels_isa isa = ISA_SCALAR;
+    
+#   ifdef HN_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        isa = ISA_AVX512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        isa = ISA_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        isa = ISA_SSE2;
+    }
+#   endif
+    
+    char *requested = getenv("HN_KERNELS");
+    if (requested != NULL) {
+        for (int cap = ISA_SCALAR; cap <= ISA_AVX512; ++cap) {
+            if (StringsAreEqual(requested, isa_names[cap])) {
+                isa = Min(isa, (enum kernels_isa)cap);
+            }
+        }
+    }
+    return isa;
+}
+
+
+static void select_kernels(void)
+{
+    enum kernels_isa isa = detect_isa();
+    
+    /* (The integer, correlation, Storkey, rank-one and saturated kernels
+     * have no SSE2 or AVX-512 versions) */
+    switch (isa) {
+#   ifdef HN_KERNELS_X86
+    case ISA_AVX512:
+        SetKernel(field_kernel, &field_avx512);
+        SetKernel(flip_kernel, &flip_avx512);
+        SetKernel(count_field_kernel, &count_field_avx2);
+        SetKernel(count_flip_kernel, &count_flip_avx2);
+        SetKernel(correlation_kernel, &correlation_tile_avx2);
+        SetKernel(distances_kernel, &distances_popcnt);
+        SetKernel(storkey_kernel, &storkey_row_avx2);
+        SetKernel(rank_one_kernel, &rank_one_row_avx2);
+        SetKernel(saturated_kernel, &saturated_row_avx2);
+        break;
+    case ISA_AVX2:
+        SetKernel(field_kernel, &field_avx2);
+        SetKernel(flip_kernel, &flip_avx2);
+        SetKernel(count_field_kernel, &count_field_avx2);
+        SetKernel(count_flip_kernel, &count_flip_avx2);
+        SetKernel(correlation_kernel, &correlation_tile_avx2);
+        SetKernel(distances_kernel, &distances_popcnt);
+        SetKernel(storkey_kernel, &storkey_row_avx2);
+        SetKernel(rank_one_kernel, &rank_one_row_avx2);
+        SetKernel(saturated_kernel, &saturated_row_avx2);
+        break;
+    case ISA_SSE2:
+        SetKernel(field_kernel, &field_sse2);
+        SetKernel(flip_kernel, &flip_sse2);
+        SetKernel(count_field_kernel, &count_field_scalar);
+        SetKernel(count_flip_kernel, &count_flip_scalar);
+        SetKernel(correlation_kernel, &correlation_tile_scalar);
+        SetKernel(distances_kernel, &distances_scalar);
+        SetKernel(storkey_kernel, &storkey_row_scalar);
+        SetKernel(rank_one_kernel, &rank_one_row_scalar);
+        SetKernel(saturated_kernel, &saturated_row_scalar);
+        break;
+#   endif
+    default:
+        SetKernel(field_kernel, &field_scalar);
+        SetKernel(flip_kernel, &flip_scalar);
+        SetKernel(count_field_kernel, &count_field_scalar);
+        SetKernel(count_flip_kernel, &count_flip_scalar);
+        SetKernel(correlation_kernel, &correlation_tile_scalar);
+        SetKernel(distances_kernel, &distances_scalar);
+        SetKernel(storkey_kernel, &storkey_row_scalar);
+        SetKernel(rank_one_kernel, &rank_one_row_scalar);
+        SetKernel(saturated_kernel, &saturated_row_scalar);
+        break;
+    }
+    __atomic_store_n(&kernels_in_use, isa, __ATOMIC_RELAXED);
+    __atomic_store_n(&kernels_selected, 1, __ATOMIC_RELEASE);
+    Logger("Selected %s kernels\n", isa_names[isa]);
+}
+
+
+static double field_resolve(double *weights_row, spike_T *activations,
+                            size_t max_units)
+{
+    select_kernels();
+    return Kernel(field_kernel)(weights_row, activations, max_units);
+}
+
+
+static long flip_resolve(double *local_fields, double *weights_row,
+                         double delta, spike_T *activations, double threshold,
+                         size_t max_units)
+{
+    select_kernels();
+    return Kernel(flip_kernel)(local_fields, weights_row, delta, activations,
+                               threshold, max_units);
+}
+
+
+static double count_field_resolve(count_T *counts_row, spike_T *activations,
+                                  size_t max_units)
+{
+    select_kernels();
+    return Kernel(count_field_kernel)(counts_row, activations, max_units);
+}
+
+
+static long count_flip_resolve(double *local_fields, count_T *counts_row,
+                               double delta, spike_T *activations,
+                               double threshold, size_t max_units)
+{
+    select_kernels();
+    return Kernel(count_flip_kernel)(local_fields, counts_row, delta,
+                                     activations, threshold, max_units);
+}
+
+
+double hn_local_field(double *weights_row, spike_T *activations,
+                      size_t max_units)
+{
+    return Kernel(field_kernel)(weights_row, activations, max_units);
+}
+
+
+long hn_propagate_flip(double *local_fields, double *weights_row,
+                       double delta, spike_T *activations, double threshold,
+                       size_t max_units)
+{
+    return Kernel(flip_kernel)(local_fields, weights_row, delta, activations,
+                               threshold, max_units);
+}
+
+
+double hn_count_local_field(count_T *counts_row, spike_T *activations,
+                            size_t max_units)
+{
+    return Kernel(count_field_kernel)(counts_row, activations, max_units);
+}
+
+
+long hn_count_propagate_flip(double *local_fields, count_T *counts_row,
+                             double delta, spike_T *activations,
+                             double threshold, size_t max_units)
+{
+    return Kernel(count_flip_kernel)(local_fields, counts_row, delta,
+                                     activations, threshold, max_units);
+}
+
+
+/*
+ * All the local fields at once (matrix-vector product): the columns are
+ * processed in blocks, so that each slice of the activations is reused
+ * from L1 by a block of rows, and the blocks of rows are shared among
+ * the OpenMP threads. The kernels are selected before entering the
+ * parallel region. The matrix-matrix versions below use the same blocks,
+ * hence sum in the same order and give the very same fields.
+ */
+
+#define FIELDS_ROW_BLOCK      8
+#define FIELDS_COLUMN_BLOCK   512
+
+
+void hn_local_fields(double *local_fields, double **weights,
+                     spike_T *activations, size_t max_units)
+{
+    hn_kernels_isa();
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += FIELDS_ROW_BLOCK) {
+        size_t row_end = Min(row_block + FIELDS_ROW_BLOCK, max_units);
+        for (size_t i = row_block; i < row_end; ++i) {
+            local_fields[i] = 0.;
+        }
+        for (size_t column_block = 0; column_block < max_units;
+             column_block += FIELDS_COLUMN_BLOCK) {
+            size_t block_length = Min(FIELDS_COLUMN_BLOCK,
+                                      max_units - column_block);
+            for (size_t i = row_block; i < row_end; ++i) {
+                local_fields[i] +=
+                    Kernel(field_kernel)(weights[i] + column_block,
+                                         activations + column_block,
+                                         block_length);
+            }
+        }
+    }
+}
+
+
+void hn_count_local_fields(double *local_fields, count_T **counts,
+                           spike_T *activations, size_t max_units)
+{
+    hn_kernels_isa();
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += FIELDS_ROW_BLOCK) {
+        size_t row_end = Min(row_block + FIELDS_ROW_BLOCK, max_units);
+        for (size_t i = row_block; i < row_end; ++i) {
+            local_fields[i] = 0.;
+        }
+        for (size_t column_block = 0; column_block < max_units;
+             column_block += FIELDS_COLUMN_BLOCK) {
+            size_t block_length = Min(FIELDS_COLUMN_BLOCK,
+                                      max_units - column_block);
+            for (size_t i = row_block; i < row_end; ++i) {
+                /* Partial sums are integers: the total stays exact */
+                local_fields[i] +=
+                    Kernel(count_field_kernel)(counts[i] + column_block,
+                                               activations + column_block,
+                                               block_length);
+            }
+        }
+    }
+}
+
+
+/*
+ * Local field of a unit while other threads may be writing the
+ * activations: each block is first copied with relaxed atomic loads
+ * (plain loads on x86), then handed to the vector kernels. The blocks
+ * are the ones of hn_local_fields(), so the result is the same.
+ */
+
+double hn_local_field_shared(double *weights_row, spike_T *activations,
+                             size_t max_units)
+{
+    spike_T snapshot[FIELDS_COLUMN_BLOCK];
+    double local_field = 0.;
+    
+    for (size_t column_block = 0; column_block < max_units;
+         column_block += FIELDS_COLUMN_BLOCK) {
+        size_t block_length = Min(FIELDS_COLUMN_BLOCK, max_units - column_block);
+        for (size_t j = 0; j < block_length; ++j) {
+            snapshot[j] = __atomic_load_n(activations + column_block + j,
+                                          __ATOMIC_RELAXED);
+        }
+        local_field += Kernel(field_kernel)(weights_row + column_block,
+                                            snapshot, block_length);
+    }
+    return local_field;
+}
+
+
+double hn_count_local_field_shared(count_T *counts_row, spike_T *activations,
+                                   size_t max_units)
+{
+    spike_T snapshot[FIELDS_COLUMN_BLOCK];
+    double local_field = 0.;
+    
+    for (size_t column_block = 0; column_block < max_units;
+         column_block += FIELDS_COLUMN_BLOCK) {
+        size_t block_length = Min(FIELDS_COLUMN_BLOCK, max_units - column_block);
+        for (size_t j = 0; j < block_length; ++j) {
+            snapshot[j] = __atomic_load_n(activations + column_block + j,
+                                          __ATOMIC_RELAXED);
+        }
+        local_field += Kernel(count_field_kernel)(counts_row + column_block,
+                                                  snapshot, block_length);
+    }
+    return local_field;
+}
+
+
+/*
+ * The local fields of several states at once (matrix-matrix product):
+ * each segment of a weight row is reused from L1 by all the states,
+ * whose slices of the current column block stay in L2.
+ */
+
+
+void hn_local_fields_batch(double **local_fields, double **weights,
+                           spike_T **states, size_t max_states,
+                           size_t max_units)
+{
+    hn_kernels_isa();
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += FIELDS_ROW_BLOCK) {
+        size_t row_end = Min(row_block + FIELDS_ROW_BLOCK, max_units);
+        for (size_t k = 0; k < max_states; ++k) {
+            for (size_t i = row_block; i < row_end; ++i) {
+                local_fields[k][i] = 0.;
+            }
+        }
+        for (size_t column_block = 0; column_block < max_units;
+             column_block += FIELDS_COLUMN_BLOCK) {
+            size_t block_length = Min(FIELDS_COLUMN_BLOCK,
+                                      max_units - column_block);
+            for (size_t i = row_block; i < row_end; ++i) {
+                double *weights_segment = weights[i] + column_block;
+                for (size_t k = 0; k < max_states; ++k) {
+                    local_fields[k][i] +=
+                        Kernel(field_kernel)(weights_segment,
+                                             states[k] + column_block,
+                                             block_length);
+                }
+            }
+        }
+    }
+}
+
+
+void hn_count_local_fields_batch(double **local_fields, count_T **counts,
+                                 spike_T **states, size_t max_states,
+                                 size_t max_units)
+{
+    hn_kernels_isa();
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += FIELDS_ROW_BLOCK) {
+        size_t row_end = Min(row_block + FIELDS_ROW_BLOCK, max_units);
+        for (size_t k = 0; k < max_states; ++k) {
+            for (size_t i = row_block; i < row_end; ++i) {
+                local_fields[k][i] = 0.;
+            }
+        }
+        for (size_t column_block = 0; column_block < max_units;
+             column_block += FIELDS_COLUMN_BLOCK) {
+            size_t block_length = Min(FIELDS_COLUMN_BLOCK,
+                                      max_units - column_block);
+            for (size_t i = row_block; i < row_end; ++i) {
+                count_T *counts_segment = counts[i] + column_block;
+                for (size_t k = 0; k < max_states; ++k) {
+                    local_fields[k][i] +=
+                        Kernel(count_field_kernel)(counts_segment,
+                                                   states[k] + column_block,
+                                                   block_length);
+                }
+            }
+        }
+    }
+}
+
+
+/*
+ * Copy of the upper triangle of a square matrix into the lower one, in
+ * square blocks (so that the column reads stay in cache), shared among
+ * the OpenMP threads; defined for each type of weights.
+ */
+
+#define MIRROR_BLOCK    64
+
+#define DefineMirror(name, type)                                            \
+static void name(type **matrix, size_t max_units)                           \
+{                                                                           \
+    _Pragma("omp parallel for schedule(dynamic)")                           \
+    for (size_t row_block = 0; row_block < max_units;                       \
+         row_block += MIRROR_BLOCK) {                                       \
+        size_t row_end = Min(row_block + MIRROR_BLOCK, max_units);          \
+        for (size_t column_block = 0; column_block <= row_block;            \
+             column_block += MIRROR_BLOCK) {                                \
+            for (size_t i = row_block; i < row_end; ++i) {                  \
+                size_t column_end = Min(column_block + MIRROR_BLOCK, i);    \
+                for (size_t j = column_block; j < column_end; ++j) {        \
+                    matrix[i][j] = matrix[j][i];                            \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+}
+
+DefineMirror(mirror_weights, double)
+DefineMirror(mirror_counts, count_T)
+
+
+/*
+ * Correlations of the patterns (symmetric rank-max_patterns update):
+ * the patterns are first copied as floats into panels of
+ * CORRELATION_PANEL units, pattern after pattern, so that a tile of
+ * CORRELATION_TILE_ROWS x CORRELATION_PANEL entries is the product of two
+ * contiguous streams and its accumulators stay in registers. Each
+ * panel of columns is reused from L2 by all the tiles above the
+ * diagonal, and the panels are shared among the OpenMP threads. The
+ * sums are integers below 2^24, hence exact in single precision (and
+ * in any order); the lower triangle is then copied from the upper one.
+ */
+
+
+void hn_correlation_update(double **weights, spike_T **patterns,
+                           size_t max_patterns, size_t max_units,
+                           double divisor, int accumulate)
+{
+    /* Beyond this, single-precision sums could be inexact */
+    KillUnless(max_patterns <= (1UL << 24));
+    hn_kernels_isa();
+    
+    size_t max_panels = (max_units + CORRELATION_PANEL - 1) / CORRELATION_PANEL;
+    size_t panel_length = Max(max_patterns, 1) * CORRELATION_PANEL;
+    float *panels = malloc(Max(max_panels, 1) * panel_length * sizeof (float));
+    KillUnless(panels != NULL);
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t p = 0; p < max_panels; ++p) {
+        float *panel = panels + p * panel_length;
+        for (size_t n = 0; n < max_patterns; ++n) {
+            for (size_t c = 0; c < CORRELATION_PANEL; ++c) {
+                size_t unit = p * CORRELATION_PANEL + c;
+                panel[n * CORRELATION_PANEL + c] =
+                    unit < max_units ? (float)patterns[n][unit] : 0.f;
+            }
+        }
+    }
+    
+    /* Column panel p meets the rows up to its last column (the later
+     * panels have more work: dynamic scheduling) */
+#   pragma omp parallel for schedule(dynamic)
+    for (size_t p = 0; p < max_panels; ++p) {
+        float tile[CORRELATION_TILE_ROWS * CORRELATION_PANEL];
+        size_t column_start = p * CORRELATION_PANEL;
+        size_t column_end = Min(column_start + CORRELATION_PANEL, max_units);
+        
+        for (size_t row_start = 0; row_start < column_end;
+             row_start += CORRELATION_TILE_ROWS) {
+            size_t row_panel = row_start / CORRELATION_PANEL;
+            Kernel(correlation_kernel)(tile, panels + row_panel * panel_length +
+                                             row_start % CORRELATION_PANEL,
+                                       panels + p * panel_length, max_patterns);
+            
+            size_t row_end = Min(row_start + CORRELATION_TILE_ROWS,
+                                 max_units);
+            for (size_t i = row_start; i < row_end; ++i) {
+                const float *counts = tile + (i - row_start) *
+                                      CORRELATION_PANEL;
+                for (size_t j = Max(i, column_start); j < column_end; ++j) {
+                    double weight = (double)counts[j - column_start] / divisor;
+                    weights[i][j] = accumulate ? weights[i][j] + weight
+                                               : weight;
+                }
+            }
+        }
+    }
+    free(panels);
+    
+    mirror_weights(weights, max_units);
+}
+
+
+/*
+ * Correlations from the unit-major bitsets of the patterns: the
+ * correlation of units i and j is max_patterns minus twice the Hamming
+ * distance of their bitsets, i.e., max_words popcounts instead of
+ * max_patterns multiply-adds. The upper triangle is computed in square
+ * blocks of BITSET_BLOCK units (whose bitsets stay in L1 for patterns
+ * in the thousands), the blocks of rows being shared among the threads.
+ */
+
+#define BITSET_BLOCK    64
+
+
+void hn_bitset_correlation_update(double **weights, count_T **counts,
+                                  const packed_spikes_T *unit_bits,
+                                  size_t max_patterns, size_t max_units,
+                                  double divisor)
+{
+    KillUnless((weights == NULL) != (counts == NULL));
+    hn_kernels_isa();
+    
+    size_t max_words = (max_patterns + SPIKES_PER_WORD - 1) / SPIKES_PER_WORD;
+    
+#   pragma omp parallel for schedule(dynamic)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += BITSET_BLOCK) {
+        uint32_t distances[BITSET_BLOCK];
+        size_t row_end = Min(row_block + BITSET_BLOCK, max_units);
+        for (size_t column_block = row_block; column_block < max_units;
+             column_block += BITSET_BLOCK) {
+            size_t column_end = Min(column_block + BITSET_BLOCK, max_units);
+            for (size_t i = row_block; i < row_end; ++i) {
+                size_t first = Max(i, column_block);
+                Kernel(distances_kernel)(distances, unit_bits + i * max_words,
+                                         unit_bits + first * max_words,
+                                         column_end - first, max_words);
+                for (size_t j = first; j < column_end; ++j) {
+                    long correlation = (long)max_patterns -
+                                       2 * (long)distances[j - first];
+                    if (weights != NULL) {
+                        weights[i][j] = (double)correlation / divisor;
+                    } else {
+                        counts[i][j] = (count_T)correlation;
+                    }
+                }
+            }
+        }
+    }
+    
+    if (weights != NULL) {
+        mirror_weights(weights, max_units);
+    } else {
+        mirror_counts(counts, max_units);
+    }
+}
+
+
+/*
+ * Storkey update in O(max_units^2): with symmetric weights and the fields
+ * h_i of the pattern x, the fields h_ij = h_i - w_ii x_i - w_ij x_j of the
+ * Storkey rule need no sum, and the increment of w_ij (i != j) is
+ *     (x_i x_j (1 + w_ii + w_jj) - (x_i h_j + h_i x_j) + 2 w_ij) / max_units,
+ * an expression symmetric in i and j (in floating point as well), so all
+ * the rows are updated independently and in place, shared among the
+ * threads. The diagonal, saved beforehand, is then set apart.
+ */
+
+
+void hn_storkey_update(double **weights, const spike_T *pattern,
+                       const double *local_fields, const spike_T *next_pattern,
+                       double *next_fields, size_t max_units,
+                       int remove_self_coupling)
+{
+    KillUnless((next_pattern == NULL) == (next_fields == NULL));
+    hn_kernels_isa();
+    
+    /* The pattern, the old diagonal and the next pattern, as doubles */
+    double *buffer = malloc(Max(3 * max_units, 1) * sizeof (double));
+    KillUnless(buffer != NULL);
+    double *activations = buffer;
+    double *diagonal = buffer + max_units;
+    double *next_activations = buffer + 2 * max_units;
+    for (size_t i = 0; i < max_units; ++i) {
+        activations[i] = pattern[i];
+        diagonal[i] = weights[i][i];
+        next_activations[i] = next_pattern != NULL ? next_pattern[i] : 0.;
+    }
+    double scale = 1. / (double)max_units;
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < max_units; ++i) {
+        double next_field = Kernel(storkey_kernel)(weights[i], activations,
+                                                   local_fields, diagonal,
+                                                   next_activations,
+                                                   activations[i],
+                                                   local_fields[i], diagonal[i],
+                                                   scale, max_units);
+        /* h_ii = h_i - w_ii x_i, and x_i x_i = 1 */
+        double self_coupling = remove_self_coupling ? 0. :
+            diagonal[i] + (1. - 2. * (activations[i] * local_fields[i] -
+                                      diagonal[i])) * scale;
+        next_field += (self_coupling - weights[i][i]) * next_activations[i];
+        weights[i][i] = self_coupling;
+        if (next_fields != NULL) {
+            next_fields[i] = next_field;
+        }
+    }
+    free(buffer);
+}
+
+
+void hn_rank_one_update(double **weights, const double *vector, double scale,
+                        size_t max_units)
+{
+    hn_kernels_isa();
+    
+    /* Entry (i, j) gets (v_i * v_j) * scale, in the same order as
+     * (j, i): the matrix stays exactly symmetric */
+#   pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < max_units; ++i) {
+        Kernel(rank_one_kernel)(weights[i], vector, vector[i], scale,
+                                max_units);
+    }
+}
+
+
+/*
+ * Saturated counts: each pattern adds x_i x_j to count (i, j), which is
+ * then clamped to [-bound, bound], so the result depends on the order
+ * of the patterns and they must be applied one after the other. The
+ * matrix is swept in tiles of SATURATED_ROW_BLOCK rows by
+ * SATURATED_COLUMN_BLOCK columns that stay in L1 while all the patterns
+ * are applied to them, so that it is read and written once whatever the
+ * number of patterns. The row blocks are shared among the threads.
+ */
+
+#define SATURATED_ROW_BLOCK     16
+#define SATURATED_COLUMN_BLOCK  512
+
+
+void hn_saturated_count_update(count_T **counts, spike_T **patterns,
+                               size_t max_patterns, size_t max_units,
+                               count_T bound)
+{
+    KillUnless(bound >= 0);
+    hn_kernels_isa();
+    
+    /* The patterns in the type of the counts, for the vector kernels */
+    count_T *activations = malloc(Max(max_patterns * max_units, 1) *
+                                  sizeof (count_T));
+    KillUnless(activations != NULL);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        for (size_t i = 0; i < max_units; ++i) {
+            activations[n * max_units + i] = (count_T)patterns[n][i];
+        }
+    }
+    
+#   pragma omp parallel for schedule(static)
+    for (size_t row_block = 0; row_block < max_units;
+         row_block += SATURATED_ROW_BLOCK) {
+        size_t row_end = Min(row_block + SATURATED_ROW_BLOCK, max_units);
+        for (size_t column_block = 0; column_block < max_units;
+             column_block += SATURATED_COLUMN_BLOCK) {
+            size_t block_length = Min(SATURATED_COLUMN_BLOCK,
+                                      max_units - column_block);
+            for (size_t n = 0; n < max_patterns; ++n) {
+                const count_T *pattern = activations + n * max_units;
+                for (size_t i = row_block; i < row_end; ++i) {
+                    Kernel(saturated_kernel)(counts[i] + column_block,
+                                             pattern + column_block, pattern[i],
+                                             bound, block_length);
+                }
+            }
+        }
+    }
+    free(activations);
+}
+
+
+/*
+ * Packed upper-triangular weights: entry (j, unit) with j < unit is read
+ * from row j, whose stride towards row j+1 is max_units - j - 1; the
+ * rest of the row of unit is contiguous and goes to the kernels above.
+ */
+
+double hn_packed_local_field(double *packed_weights, size_t unit,
+                             spike_T *activations, size_t max_units)
+{
+    double local_field = 0.;
+    double *weight = packed_weights + unit;
+    /* Column segment */
+    for (size_t j = 0; j < unit; ++j) {
+        local_field += *weight * activations[j];
+        weight += max_units - j - 1;
+    }
+    /* Row segment (weight now points at the diagonal entry) */
+    return local_field + Kernel(field_kernel)(weight, activations + unit,
+                                              max_units - unit);
+}
+
+
+long hn_packed_propagate_flip(double *local_fields, double *packed_weights,
+                              size_t unit, double delta, spike_T *activations,
+                              double threshold, size_t max_units)
+{
+    long change = 0;
+    double *weight = packed_weights + unit;
+    /* Column segment */
+    for (size_t j = 0; j < unit; ++j) {
+        change -= UnitIsUnstable(local_fields[j], activations[j], threshold);
+        local_fields[j] += delta * *weight;
+        change += UnitIsUnstable(local_fields[j], activations[j], threshold);
+        weight += max_units - j - 1;
+    }
+    /* Row segment */
+    return change + Kernel(flip_kernel)(local_fields + unit, weight, delta,
+                                        activations + unit, threshold,
+                                        max_units - unit);
+}
+
+
+/*
+ * Sparse (CSR) rows: only the nonzeros are visited. The accesses to the
+ * activations and fields are indirect, so these are scalar loops.
+ */
+
+double hn_sparse_local_field(double *values, uint32_t *columns,
+                             size_t row_length, spike_T *activations)
+{
+    double local_field = 0.;
+    for (size_t k = 0; k < row_length; ++k) {
+        local_field += values[k] * activations[columns[k]];
+    }
+    return local_field;
+}
+
+
+long hn_sparse_propagate_flip(double *local_fields, double *values,
+                              uint32_t *columns, size_t row_length,
+                              double delta, spike_T *activations,
+                              double threshold)
+{
+    long change = 0;
+    for (size_t k = 0; k < row_length; ++k) {
+        uint32_t j = columns[k];
+        change -= UnitIsUnstable(local_fields[j], activations[j], threshold);
+        local_fields[j] += delta * values[k];
+        change += UnitIsUnstable(local_fields[j], activations[j], threshold);
+    }
+    return change;
+}
+
+
+const char *hn_kernels_isa(void)
+{
+    if (!__atomic_load_n(&kernels_selected, __ATOMIC_ACQUIRE)) {
+        select_kernels();
+    }
+    return isa_names[__atomic_load_n(&kernels_in_use, __ATOMIC_RELAXED)];
+}
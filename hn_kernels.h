@@ -0,0 +1,361 @@
+/*****************************************************
+ * HEADER FILE: hn_kernels.h                         *
+ * MODULE: Local field kernels                       *
+ *                                                   *
+ * FUNCTION: Inner loops of the simulation (local    *
+ *           fields and their update after a flip),  *
+ *           in SSE2/AVX2/AVX-512 versions selected  *
+ *           once at run time                        *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_KERNELS_H
+#define HN_KERNELS_H
+
+#include "hn_types.h"
+
+#include <stdlib.h>
+
+
+
+/*
+ * The kernels are chosen at the first call, according to the instruction
+ * sets supported by the CPU. The choice can be capped by setting the
+ * environment variable HN_KERNELS to "scalar", "sse2", "avx2" or "avx512".
+ */
+
+
+/**
+ * Compute the local field of a unit (dot product of its weight row
+ * with the activations).
+ *
+ * \param weights_row   row of the weight matrix (max_units long)
+ * \param activations   the state of the network
+ * \param max_units     the size of the network
+ *
+ * \return              the local field
+ */
+double hn_local_field(double *weights_row, spike_T *activations,
+                      size_t max_units);
+
+
+/**
+ * Add delta * weights_row to the local fields (the effect of a flip
+ * of the unit whose, symmetric, weight row is passed) and return how
+ * much the number of unstable units has changed.
+ *
+ * \param local_fields  the fields to be updated (max_units long)
+ * \param weights_row   row of the weight matrix (max_units long)
+ * \param delta         the change of activation of the flipped unit
+ * \param activations   the state of the network (after the flip)
+ * \param threshold     the threshold of the activation function
+ * \param max_units     the size of the network
+ *
+ * \return              (unstable units after) - (unstable units before)
+ */
+long hn_propagate_flip(double *local_fields, double *weights_row,
+                       double delta, spike_T *activations, double threshold,
+                       size_t max_units);
+
+
+/**
+ * Same as hn_local_field() for a row of integer counts: the result is
+ * the exact (integer) sum of counts_row[i] * activations[i].
+ *
+ * \param counts_row    row of the count matrix (max_units long)
+ * \param activations   the state of the network
+ * \param max_units     the size of the network
+ *
+ * \return              the unscaled local field
+ */
+double hn_count_local_field(count_T *counts_row, spike_T *activations,
+                            size_t max_units);
+
+
+/**
+ * Same as hn_propagate_flip() for a row of integer counts; the fields and
+ * the threshold are unscaled, and the fields stay exact integers.
+ *
+ * \param local_fields  the unscaled fields to be updated (max_units long)
+ * \param counts_row    row of the count matrix (max_units long)
+ * \param delta         the change of activation of the flipped unit
+ * \param activations   the state of the network (after the flip)
+ * \param threshold     the threshold divided by the scale of the counts
+ * \param max_units     the size of the network
+ *
+ * \return              (unstable units after) - (unstable units before)
+ */
+long hn_count_propagate_flip(double *local_fields, count_T *counts_row,
+                             double delta, spike_T *activations,
+                             double threshold, size_t max_units);
+
+
+/**
+ * Compute the local fields of all the units (matrix-vector product),
+ * blocked for cache and split among OpenMP threads when enabled.
+ *
+ * \param local_fields  the fields to be filled (max_units long)
+ * \param weights       the max_units * max_units weight matrix
+ * \param activations   the state of the network
+ * \param max_units     the size of the network
+ */
+void hn_local_fields(double *local_fields, double **weights,
+                     spike_T *activations, size_t max_units);
+
+
+/**
+ * Same as hn_local_fields() for a matrix of integer counts
+ * (the fields are unscaled and exact).
+ *
+ * \param local_fields  the unscaled fields to be filled (max_units long)
+ * \param counts        the max_units * max_units count matrix
+ * \param activations   the state of the network
+ * \param max_units     the size of the network
+ */
+void hn_count_local_fields(double *local_fields, count_T **counts,
+                           spike_T *activations, size_t max_units);
+
+
+/**
+ * Same as hn_local_field() when other threads may update the activations
+ * concurrently (they must do so with relaxed atomic stores): the result
+ * is the one hn_local_fields() gives for the state that was read.
+ *
+ * \param weights_row   row of the weight matrix (max_units long)
+ * \param activations   the state of the network, shared among threads
+ * \param max_units     the size of the network
+ *
+ * \return              the local field
+ */
+double hn_local_field_shared(double *weights_row, spike_T *activations,
+                             size_t max_units);
+
+
+/**
+ * Same as hn_local_field_shared() for a row of integer counts.
+ *
+ * \param counts_row    row of the count matrix (max_units long)
+ * \param activations   the state of the network, shared among threads
+ * \param max_units     the size of the network
+ *
+ * \return              the unscaled local field
+ */
+double hn_count_local_field_shared(count_T *counts_row, spike_T *activations,
+                                   size_t max_units);
+
+
+/**
+ * Compute the local fields of all the units for several states of the
+ * network at once (matrix-matrix product), blocked so that each tile of
+ * the weights is reused by all the states, and split among OpenMP threads.
+ *
+ * \param local_fields  max_states arrays of fields to be filled
+ * \param weights       the max_units * max_units weight matrix
+ * \param states        max_states states of the network
+ * \param max_states    the number of states
+ * \param max_units     the size of the network
+ */
+void hn_local_fields_batch(double **local_fields, double **weights,
+                           spike_T **states, size_t max_states,
+                           size_t max_units);
+
+
+/**
+ * Same as hn_local_fields_batch() for a matrix of integer counts.
+ *
+ * \param local_fields  max_states arrays of unscaled fields to be filled
+ * \param counts        the max_units * max_units count matrix
+ * \param states        max_states states of the network
+ * \param max_states    the number of states
+ * \param max_units     the size of the network
+ */
+void hn_count_local_fields_batch(double **local_fields, count_T **counts,
+                                 spike_T **states, size_t max_states,
+                                 size_t max_units);
+
+
+/**
+ * Symmetric rank-max_patterns update of a weight matrix with the
+ * correlations of the patterns: entries i, j become
+ * c_ij / divisor, or are incremented by it if accumulate is non-zero,
+ * where c_ij = sum_n patterns[n][i] * patterns[n][j] is computed exactly.
+ * Only the upper triangle is computed (in cache-blocked, register-sized
+ * tiles split among OpenMP threads) and then mirrored, so the matrix
+ * must be symmetric beforehand when accumulating.
+ *
+ * \param weights       the max_units * max_units matrix to be updated
+ * \param patterns      the patterns (+1/-1)
+ * \param max_patterns  the number of patterns (at most 2^24)
+ * \param max_units     the size of the network
+ * \param divisor       the normalisation of the correlations
+ * \param accumulate    non-zero to add to the weights, 0 to overwrite them
+ */
+void hn_correlation_update(double **weights, spike_T **patterns,
+                           size_t max_patterns, size_t max_units,
+                           double divisor, int accumulate);
+
+
+/**
+ * Same as hn_correlation_update() (without accumulation) from the
+ * unit-major bitsets of the patterns (see hn_pack_patterns_transposed()
+ * in hn_bitpack.h): each correlation is max_patterns minus twice the
+ * Hamming distance of two bitsets, counted with popcounts. Exactly one
+ * of weights and counts must be given: double weights become
+ * correlation / divisor, integer counts the correlation itself.
+ *
+ * \param weights       the max_units * max_units matrix to be filled,
+ *                      or NULL
+ * \param counts        the max_units * max_units counts to be filled,
+ *                      or NULL
+ * \param unit_bits     max_units bitsets of hn_packed_length(max_patterns)
+ *                      words each
+ * \param max_patterns  the number of patterns
+ * \param max_units     the size of the network
+ * \param divisor       the normalisation of the double weights
+ */
+void hn_bitset_correlation_update(double **weights, count_T **counts,
+                                  const packed_spikes_T *unit_bits,
+                                  size_t max_patterns, size_t max_units,
+                                  double divisor);
+
+
+/**
+ * Storkey update of a symmetric weight matrix with a pattern, in
+ * O(max_units^2) given the local fields of the pattern (every row is
+ * updated in place, rows split among OpenMP threads). If a next pattern
+ * is given, its local fields in the updated weights are computed in the
+ * same pass, ready for the next update.
+ *
+ * \param weights               the max_units * max_units matrix to be updated
+ * \param pattern               the pattern to be learnt
+ * \param local_fields          the local fields of pattern (weights times it)
+ * \param next_pattern          the next pattern to be learnt, or NULL
+ * \param next_fields           its local fields to be filled (max_units
+ *                              long), or NULL with next_pattern
+ * \param max_units             the size of the network
+ * \param remove_self_coupling  non-zero to set the diagonal to 0, 0 to
+ *                              apply the rule to it as well
+ */
+void hn_storkey_update(double **weights, const spike_T *pattern,
+                       const double *local_fields, const spike_T *next_pattern,
+                       double *next_fields, size_t max_units,
+                       int remove_self_coupling);
+
+
+/**
+ * Symmetric rank-one update weights += scale * vector vector^T (rows
+ * split among OpenMP threads); a symmetric matrix stays exactly so.
+ *
+ * \param weights       the max_units * max_units matrix to be updated
+ * \param vector        the vector of the update (max_units long)
+ * \param scale         the coefficient of the outer product
+ * \param max_units     the size of the network
+ */
+void hn_rank_one_update(double **weights, const double *vector, double scale,
+                        size_t max_units);
+
+
+/**
+ * Add the autocorrelations of several patterns, one after the other, to
+ * a matrix of integer counts, clamping every count to [-bound, bound]
+ * after each pattern (saturated synapses). The clamps are branch-free,
+ * and the matrix is updated in cache-sized tiles that receive all the
+ * patterns at once, split among OpenMP threads.
+ *
+ * \param counts        the max_units * max_units counts to be updated
+ * \param patterns      the patterns (+1/-1), in the order of learning
+ * \param max_patterns  the number of patterns
+ * \param max_units     the size of the network
+ * \param bound         the largest absolute value of a count
+ */
+void hn_saturated_count_update(count_T **counts, spike_T **patterns,
+                               size_t max_patterns, size_t max_units,
+                               count_T bound);
+
+
+/**
+ * Same as hn_local_field() for a symmetric matrix in packed
+ * upper-triangular storage (see PackedRowOffset): the weights of unit
+ * j < unit are read down a column, the others along a row.
+ *
+ * \param packed_weights  the packed weight matrix
+ * \param unit            the index of the unit
+ * \param activations     the state of the network
+ * \param max_units       the size of the network
+ *
+ * \return                the local field
+ */
+double hn_packed_local_field(double *packed_weights, size_t unit,
+                             spike_T *activations, size_t max_units);
+
+
+/**
+ * Same as hn_propagate_flip() for a symmetric matrix in packed
+ * upper-triangular storage.
+ *
+ * \param local_fields    the fields to be updated (max_units long)
+ * \param packed_weights  the packed weight matrix
+ * \param unit            the index of the flipped unit
+ * \param delta           the change of activation of the flipped unit
+ * \param activations     the state of the network (after the flip)
+ * \param threshold       the threshold of the activation function
+ * \param max_units       the size of the network
+ *
+ * \return                (unstable units after) - (unstable units before)
+ */
+long hn_packed_propagate_flip(double *local_fields, double *packed_weights,
+                              size_t unit, double delta, spike_T *activations,
+                              double threshold, size_t max_units);
+
+
+/**
+ * Same as hn_local_field() for a row of a sparse (CSR) matrix.
+ *
+ * \param values        the nonzero weights of the row
+ * \param columns       the columns of the nonzero weights
+ * \param row_length    the number of nonzero weights
+ * \param activations   the state of the network
+ *
+ * \return              the local field
+ */
+double hn_sparse_local_field(double *values, uint32_t *columns,
+                             size_t row_length, spike_T *activations);
+
+
+/**
+ * Same as hn_propagate_flip() for a row of a sparse (CSR) matrix with
+ * symmetric pattern of nonzeros: only the fields of the units connected
+ * to the flipped one change.
+ *
+ * \param local_fields  the fields to be updated
+ * \param values        the nonzero weights of the row of the flipped unit
+ * \param columns       the columns of the nonzero weights
+ * \param row_length    the number of nonzero weights
+ * \param delta         the change of activation of the flipped unit
+ * \param activations   the state of the network (after the flip)
+ * \param threshold     the threshold of the activation function
+ *
+ * \return              (unstable units after) - (unstable units before)
+ */
+long hn_sparse_propagate_flip(double *local_fields, double *values,
+                              uint32_t *columns, size_t row_length,
+                              double delta, spike_T *activations,
+                              double threshold);
+
+
+/**
+ * Name of the instruction set of the kernels in use
+ * ("scalar", "sse2", "avx2" or "avx512").
+ */
+const char *hn_kernels_isa(void);
+
+
+#endif /* HN_KERNELS_H */
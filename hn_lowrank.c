@@ -0,0 +1,201 @@
+/*****************************************************
+ * C FILE: hn_lowrank.c                              *
+ * MODULE: Matrix-free simulation                    *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "debug_log.h"
+#include "hn_lowrank.h"
+#include "hn_macro_utils.h"
+#include "hn_rng.h"
+#include "hn_types.h"
+
+#include <stdlib.h>
+
+
+/**
+ * The local field of unit i, multiplied by max_units (hence an integer):
+ * sum_n patterns[n][i] * overlaps[n], minus the diagonal contribution
+ * max_patterns * activations[i] if the self-coupling is suppressed.
+ */
+static long lowrank_scaled_field(hn_lowrank_network net, long *overlaps,
+                                 size_t unit)
+{
+    int8_t *unit_row = net.unit_patterns + unit * net.pattern_capacity;
+    long scaled_field = 0;
+    
+    for (size_t n = 0; n < net.max_patterns; ++n) {
+        scaled_field += unit_row[n] * overlaps[n];
+    }
+    if (net.remove_self_coupling) {
+        scaled_field -= (long)net.max_patterns * net.activations[unit];
+    }
+    return scaled_field;
+}
+
+
+/* The activation function applied to the field of the unit */
+static spike_T lowrank_activation(hn_lowrank_network net, long *overlaps,
+                                  size_t unit, size_t max_units)
+{
+    long scaled_field = lowrank_scaled_field(net, overlaps, unit);
+    return Sign(scaled_field / (double)max_units - net.threshold);
+}
+
+
+/* Count the units that would flip if updated: O(max_units * max_patterns) */
+static size_t lowrank_unstable_units(hn_lowrank_network net, long *overlaps,
+                                     size_t max_units)
+{
+    size_t unstable_units = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        unstable_units += lowrank_activation(net, overlaps, i, max_units) !=
+                          net.activations[i];
+    }
+    return unstable_units;
+}
+
+
+hn_lowrank_network hn_lowrank_network_alloc(size_t max_units,
+                                            size_t pattern_capacity,
+                                            double threshold,
+                                            int remove_self_coupling)
+{
+    hn_lowrank_network net;
+    
+    net.unit_patterns = malloc(max_units * pattern_capacity *
+                               sizeof (*net.unit_patterns));
+    KillUnless(net.unit_patterns != NULL);
+    net.pattern_capacity = pattern_capacity;
+    net.max_patterns = 0;
+    net.remove_self_coupling = remove_self_coupling;
+    net.activations = NULL;
+    net.threshold = threshold;
+    Logger("Low-rank network data-structure successfully created\n");
+    return net;
+}
+
+
+void hn_lowrank_free(hn_lowrank_network net)
+{
+    Logger("Freeing stored patterns...\n");
+    free(net.unit_patterns);
+    net.unit_patterns = NULL;
+    Logger("done!\n");
+}
+
+
+void hn_lowrank_add_pattern(hn_lowrank_network *net, spike_T *pattern,
+                            size_t max_units)
+{
+    KillUnless(net->max_patterns < net->pattern_capacity);
+    
+    /* The new pattern becomes a column of the unit-major matrix */
+    for (size_t i = 0; i < max_units; ++i) {
+        net->unit_patterns[i * net->pattern_capacity + net->max_patterns] =
+            (int8_t)pattern[i];
+    }
+    ++net->max_patterns;
+}
+
+
+void hn_lowrank_from_patterns(hn_lowrank_network *net, spike_T **patterns,
+                              size_t max_patterns, size_t max_units)
+{
+    net->max_patterns = 0;
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_lowrank_add_pattern(net, patterns[n], max_units);
+    }
+}
+
+
+long hn_lowrank_test_pattern(hn_lowrank_network net, spike_T *pattern,
+                             size_t max_units, size_t warning_threshold,
+                             hn_mode_utils utils)
+{
+    long update_counter = 0;
+    /* At least one initial pattern must be present */
+    KillUnless(pattern != NULL || net.activations != NULL);
+    /* If pattern is specified, it overrides the network activations */
+    if (net.activations == NULL) {
+        Logger("net.activations == NULL\n");
+        net.activations = pattern;
+    }
+    KillUnless(utils.mode == MODE_SEQUENTIAL || utils.mode == MODE_RANDOM);
+    /* (The updates here are all zero-temperature ones) */
+    KillUnless(utils.schedule == NULL);
+    
+    /* Overlaps of the initial state with every stored pattern */
+    long *overlaps = calloc(Max(net.max_patterns, 1), sizeof (long));
+    KillUnless(overlaps != NULL);
+    for (size_t i = 0; i < max_units; ++i) {
+        int8_t *unit_row = net.unit_patterns + i * net.pattern_capacity;
+        for (size_t n = 0; n < net.max_patterns; ++n) {
+            overlaps[n] += unit_row[n] * net.activations[i];
+        }
+    }
+    
+    /* There are no cached fields here: the number of unstable units
+     * is recounted whenever the stability warning is issued */
+    hn_dynamics dynamics;
+    dynamics.local_fields = NULL;
+    dynamics.worklist = NULL;
+    dynamics.worklist_positions = NULL;
+    dynamics.heap = NULL;
+    dynamics.heap_positions = NULL;
+    dynamics.permutation = NULL;
+    dynamics.selector_position = 0;
+    dynamics.stability_counter = 0;
+    dynamics.trace = NULL;
+    if (utils.mode == MODE_RANDOM) {
+        hn_rng_seed_from_rand(&dynamics.rng);
+    }
+    dynamics.unstable_units = lowrank_unstable_units(net, overlaps, max_units);
+    
+    /* Resetting the selector before analysing a new pattern
+     * (mandatory with the sequential selector) */
+    utils.select_unit(&dynamics, max_units, 1);
+    
+    Logger("Initiating main-test loop...\n");
+    while (!utils.stability_check(&dynamics, max_units)) {
+        int unit_has_flipped;
+        do {
+            size_t index_to_update = utils.select_unit(&dynamics, max_units,
+                                                       0);
+            spike_T new_activation =
+                lowrank_activation(net, overlaps, index_to_update, max_units);
+            
+            unit_has_flipped =
+                new_activation != net.activations[index_to_update];
+            if (unit_has_flipped) {
+                /* Only the overlaps need to follow the flip: O(max_patterns) */
+                int8_t *unit_row = net.unit_patterns +
+                                   index_to_update * net.pattern_capacity;
+                long delta = 2 * new_activation;
+                for (size_t n = 0; n < net.max_patterns; ++n) {
+                    overlaps[n] += delta * unit_row[n];
+                }
+                net.activations[index_to_update] = new_activation;
+            }
+            ++update_counter;
+            
+        } while (!utils.stability_warning(&dynamics, unit_has_flipped,
+                                          warning_threshold));
+        
+        dynamics.unstable_units = lowrank_unstable_units(net, overlaps,
+                                                         max_units);
+    }
+    Logger("Exiting main-test loop\n\n");
+    
+    free(overlaps);
+    
+    return update_counter;
+}
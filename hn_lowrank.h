@@ -0,0 +1,101 @@
+/*****************************************************
+ * HEADER FILE: hn_lowrank.h                         *
+ * MODULE: Matrix-free simulation                    *
+ *                                                   *
+ * FUNCTION: Recall for Hebbian networks in pattern  *
+ *           space, without building the weight      *
+ *           matrix: O(max_patterns) per update and  *
+ *           O(max_units * max_patterns) memory      *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_LOWRANK_H
+#define HN_LOWRANK_H
+
+#include "hn_types.h"
+
+#include <stdlib.h>
+
+
+
+/**
+ * Create an empty low-rank network, with room for pattern_capacity patterns
+ * (the pattern storage is allocated here and released by hn_lowrank_free()).
+ *
+ * \param max_units             the size of the network
+ * \param pattern_capacity      the maximum number of patterns to be learnt
+ * \param threshold             the threshold of the activation function
+ * \param remove_self_coupling  non-zero to suppress the diagonal, 0 otherwise
+ *
+ * \return                      the structure representing the network
+ */
+hn_lowrank_network hn_lowrank_network_alloc(size_t max_units,
+                                            size_t pattern_capacity,
+                                            double threshold,
+                                            int remove_self_coupling);
+
+
+/**
+ * Free the pattern storage of a low-rank network (the activations
+ * belong to the user).
+ *
+ * \param net     the low-rank network
+ */
+void hn_lowrank_free(hn_lowrank_network net);
+
+
+/**
+ * Learn a pattern; equivalent to hn_hebb_weights_increment_with_pattern()
+ * on the implicit weight matrix.
+ *
+ * \param net          pointer to the low-rank network
+ * \param pattern      the pattern to be learnt
+ * \param max_units    the size of the network
+ */
+void hn_lowrank_add_pattern(hn_lowrank_network *net, spike_T *pattern,
+                            size_t max_units);
+
+
+/**
+ * Learn a list of patterns; equivalent to hn_hebb_weights_from_patterns()
+ * on the implicit weight matrix (previously learnt patterns are forgotten).
+ *
+ * \param net          pointer to the low-rank network
+ * \param patterns     list of spike_T patterns
+ * \param max_patterns the number of patterns
+ * \param max_units    the size of the network
+ */
+void hn_lowrank_from_patterns(hn_lowrank_network *net, spike_T **patterns,
+                              size_t max_patterns, size_t max_units);
+
+
+/**
+ * Same as hn_test_pattern() for a low-rank network: the overlaps with the
+ * stored patterns are kept up to date, so each update costs O(max_patterns);
+ * the hard stability check rescans all the units in
+ * O(max_units * max_patterns). Only MODE_SEQUENTIAL and MODE_RANDOM
+ * are supported, and without an annealing schedule (utils.schedule
+ * must be NULL).
+ *
+ * \param net               the low-rank network
+ * \param pattern           the initial pattern that we want to test
+ * \param max_units         the size of the network
+ * \param warning_threshold stable-unit counter threshold
+ * \param utils             functions to be used, depending on update mode
+ *
+ * \return                  the number of unit updates until convergence
+ */
+long hn_lowrank_test_pattern(hn_lowrank_network net, spike_T *pattern,
+                             size_t max_units, size_t warning_threshold,
+                             hn_mode_utils utils);
+
+
+#endif /* HN_LOWRANK_H */
@@ -0,0 +1,95 @@
+/*****************************************************
+ * C FILE (main): hn_lowrank_test.c                  *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the matrix-free recall with    *
+ *           the one on the explicit Hebbian weights *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_lowrank.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define MAX_UNITS 400
+#define MAX_PATTERNS 20
+#define MAX_TESTS 10
+#define FLIP_PROBABILITY 0.1
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t mismatches = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Low-rank recall vs. explicit weights\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    
+    hn_lowrank_network lowrank = hn_lowrank_network_alloc(max_units,
+                                                          max_patterns, 0., 1);
+    hn_lowrank_from_patterns(&lowrank, patterns, max_patterns, max_units);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_SEQUENTIAL);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *lowrank_probe = hn_pattern_copy(probe, max_units);
+        
+        hn_network net = hn_network_from_params(weights, 0., probe);
+        long updates = hn_test_pattern(net, NULL, max_units, max_units, utils);
+        long lowrank_updates = hn_lowrank_test_pattern(lowrank, lowrank_probe,
+                                                       max_units, max_units,
+                                                       utils);
+        size_t overlaps = hn_overlap_frequency(probe, lowrank_probe, max_units);
+        
+        printf("Probe %zu: updates = %ld (low-rank: %ld); "
+               "final states overlap = %zu/%zu\n",
+               n, updates, lowrank_updates, overlaps, max_units);
+        mismatches += overlaps != max_units;
+        
+        free(probe);
+        free(lowrank_probe);
+    }
+    
+    printf("\n%s\n", mismatches == 0 ? "All final states coincide"
+                                     : "Some final states differ!");
+    
+    hn_lowrank_free(lowrank);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -30,31 +30,133 @@
 #define Min(a, b)   ((a) < (b) ? (a) : (b))
 
 
+/* Exchange the values of two variables of the given type */
+#define SwapValues(a, b, type)                                          \
+    do {                                                                \
+        type SWAP_VALUES_TMP = (a);                                     \
+        (a) = (b);                                                      \
+        (b) = SWAP_VALUES_TMP;                                          \
+    } while(0)
+
+
 /* The activation function we use */
 #define Sign(x)     ((x) >= 0 ? +1 : -1)
 
 
+/* A unit is unstable if the activation function would flip it */
+#define UnitIsUnstable(field, activation, threshold)    \
+    (Sign((field) - (threshold)) != (activation))
+
+
+/* Functions whose inlining is mandatory (e.g., bodies shared by several
+ * specialisations, where some arguments become constants) */
+#if defined(__GNUC__) || defined(__clang__)
+#  define ALWAYS_INLINE     inline __attribute__((always_inline))
+#else
+#  define ALWAYS_INLINE     inline
+#endif
+
+
 /* Extract a random integer 0 <= n <= size-1
  * (approximately uniform if size << RAND_MAX) */
 #define RandI(size)     (rand() / (1 + RAND_MAX / (size)))
 
 
+/* Number of set bits in a 64-bit word */
+#if defined(__GNUC__) || defined(__clang__)
+
+#define PopCount(x)     __builtin_popcountll(x)
+
+#else
+
+#define PopCount(x)     pop_count_64(x)
+
+static inline int pop_count_64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+#endif /* __GNUC__ || __clang__ */
+
+
 /*
  * The following are polymorphic macros that allocate and free 2D arrays.
  * Based on make_matrix() and matrix_free() found in
  *
  *      R. Rostamian, "Programming Projects in C", SIAM.
+ *
+ * All the rows live in a single block aligned to MATRIX_ALIGNMENT bytes,
+ * each padded to a multiple of MATRIX_ALIGNMENT bytes (the element size
+ * must divide it); the NULL-terminated array of row pointers is kept, so
+ * mat[i][j] works as usual, while kernels can use the flat block
+ * MatrixData(mat) with row stride MatrixStride(mat, max_cols) elements.
+ *
+ * Compiling with -D HN_HUGE_PAGES -D _DEFAULT_SOURCE backs the blocks
+ * larger than a huge page with transparent huge pages (Linux only).
  */
 
+#define MATRIX_ALIGNMENT    64
+
+#define HUGE_PAGE_SIZE      (2UL << 20)
+
+#ifdef HN_HUGE_PAGES
+#  include <sys/mman.h>
+#endif
+
+
+/* Row stride (in elements) of a matrix with max_cols columns */
+#define MatrixStride(mat, max_cols)                                     \
+    (((max_cols) * sizeof (**(mat)) + MATRIX_ALIGNMENT - 1)             \
+     / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT / sizeof (**(mat)))
+
+
+/* The contiguous block holding all the elements */
+#define MatrixData(mat)     ((mat)[0])
+
+
+/* Allocate an aligned block for the elements of a matrix */
+static inline void *matrix_block_alloc(size_t bytes)
+{
+    size_t alignment = MATRIX_ALIGNMENT;
+    
+#   if defined(HN_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+    if (bytes >= HUGE_PAGE_SIZE) {
+        alignment = HUGE_PAGE_SIZE;
+    }
+#   endif
+    
+    /* aligned_alloc() wants a (non-zero) multiple of the alignment */
+    bytes = Max((bytes + alignment - 1) / alignment * alignment, alignment);
+    void *block = aligned_alloc(alignment, bytes);
+    KillUnless(block != NULL);
+    
+#   if defined(HN_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+    if (alignment == HUGE_PAGE_SIZE && madvise(block, bytes, MADV_HUGEPAGE)) {
+        /* Only a hint: carry on with normal pages */
+        errno = 0;
+    }
+#   endif
+    
+    return block;
+}
+
+
 #define MatrixAlloc(mat, max_rows, max_cols)                            \
     do {                                                                \
         size_t MATRIX_ALLOC_I;                                          \
+        size_t MATRIX_ALLOC_STRIDE = MatrixStride((mat), (max_cols));   \
         (mat) = malloc(((max_rows)+1) * sizeof (*(mat)));               \
         KillUnless(NULL != (mat));                                      \
         (mat)[(max_rows)] = NULL; /* Terminal element */                \
-        for (MATRIX_ALLOC_I = 0; MATRIX_ALLOC_I < (max_rows); ++MATRIX_ALLOC_I) { \
-            (mat)[MATRIX_ALLOC_I] = malloc((max_cols) * sizeof (**(mat))); \
-            KillUnless(NULL != (mat)[MATRIX_ALLOC_I]);                  \
+        if ((max_rows) > 0) {                                           \
+            (mat)[0] = matrix_block_alloc((max_rows) * MATRIX_ALLOC_STRIDE \
+                                          * sizeof (**(mat)));          \
+        }                                                               \
+        for (MATRIX_ALLOC_I = 1; MATRIX_ALLOC_I < (max_rows); ++MATRIX_ALLOC_I) { \
+            (mat)[MATRIX_ALLOC_I] = (mat)[0] + MATRIX_ALLOC_I * MATRIX_ALLOC_STRIDE; \
         }                                                               \
     } while(0)
 
@@ -62,26 +164,33 @@
 /* This is in case we want to fill the matrix with zeros. */
 #define MatrixZeros(mat, max_rows, max_cols)                            \
     do {                                                                \
-        size_t MATRIX_ALLOC_I;                                          \
-        (mat) = malloc(((max_rows) + 1) * sizeof (*(mat)));             \
-        KillUnless((mat) != NULL);                                      \
-        (mat)[(max_rows)] = NULL; /* Terminal element */                \
-        for (MATRIX_ALLOC_I = 0; MATRIX_ALLOC_I < (max_rows); ++MATRIX_ALLOC_I) { \
-            (mat)[MATRIX_ALLOC_I] = malloc((max_cols) * sizeof (**(mat))); \
-            KillUnless(NULL != (mat)[MATRIX_ALLOC_I]);                  \
-            memset((mat)[MATRIX_ALLOC_I], 0, (max_cols) * sizeof(**(mat))); \
+        MatrixAlloc((mat), (max_rows), (max_cols));                     \
+        if ((max_rows) > 0) {                                           \
+            memset((mat)[0], 0, (max_rows) * MatrixStride((mat), (max_cols)) \
+                                * sizeof (**(mat)));                    \
         }                                                               \
     } while(0)
 
 
 #define MatrixFree(mat)                                                 \
     do {                                                                \
-        size_t MATRIX_FREE_I = 0;                                       \
-        while ((mat)[MATRIX_FREE_I] != NULL) {                          \
-            free((mat)[MATRIX_FREE_I++]);                               \
-        }                                                               \
+        free((mat)[0]); /* The whole block (or NULL if no rows) */      \
         free((mat));                                                    \
     } while(0)
 
 
+
+/*
+ * Packed upper-triangular storage of a symmetric max_units * max_units
+ * matrix in a flat array: row i holds entries i..max_units-1 (diagonal
+ * first) and immediately follows row i-1, so entry (i, j) with i <= j
+ * is found at PackedRowOffset(i, max_units) + j - i.
+ */
+
+#define PackedMatrixLength(max_units)   ((max_units) * ((max_units) + 1) / 2)
+
+#define PackedRowOffset(i, max_units)                                   \
+    ((i) * (max_units) - (i) * ((i) - 1) / 2)
+
+
 #endif /* HN_MACRO_UTILS_H */
@@ -18,6 +18,7 @@
 #include "hn_types.h"
 #include "hn_macro_utils.h"
 #include "hn_modes.h"
+#include "hn_rng.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -27,110 +28,130 @@ hn_mode_utils hn_utils_with_mode(enum hn_mode update_mode)
 {
     hn_mode_utils utils;
     
-    if (update_mode == MODE_SEQUENTIAL) {
-
-	utils.select_unit = &sequential_select_unit;
-	utils.stability_warning = &sequential_stability_warning;
-	utils.stability_check = &sequential_stability_check;
-        
-    } else {  /* the only other option: MODE_RANDOM */
+    utils.mode = update_mode;
+    utils.schedule = NULL;
+    
+    /* (The sweeping modes get the sequential functions) */
+    if (update_mode == MODE_RANDOM) {
         
         utils.select_unit = &random_select_unit;
 	utils.stability_warning = &sequential_stability_warning;
 	utils.stability_check = &random_stability_check;
         
+    } else if (update_mode == MODE_WORKLIST) {
+        
+        utils.select_unit = &worklist_select_unit;
+        utils.stability_warning = &worklist_stability_warning;
+        utils.stability_check = &worklist_stability_check;
+        
+    } else if (update_mode == MODE_GREEDY) {
+        
+        /* Every update flips a unit here too */
+        utils.select_unit = &greedy_select_unit;
+        utils.stability_warning = &worklist_stability_warning;
+        utils.stability_check = &worklist_stability_check;
+        
+    } else if (update_mode == MODE_RANDOM_PERMUTATION) {
+        
+        utils.select_unit = &permutation_select_unit;
+        utils.stability_warning = &sequential_stability_warning;
+        utils.stability_check = &sequential_stability_check;
+        
+    } else {
+
+	utils.select_unit = &sequential_select_unit;
+	utils.stability_warning = &sequential_stability_warning;
+	utils.stability_check = &sequential_stability_check;
+        
     }
     
     return utils;
 }
 
 
-size_t sequential_select_unit(size_t max_units, int reset)
+int hn_utils_are_standard(hn_mode_utils utils)
 {
-    static size_t counter = 0;
-
-    if (reset) {
-        return (counter = 0);
-    } else {
-        return counter++ % max_units;
-    }
+    hn_mode_utils standard = hn_utils_with_mode(utils.mode);
+    
+    return utils.select_unit == standard.select_unit &&
+           utils.stability_warning == standard.stability_warning &&
+           utils.stability_check == standard.stability_check;
 }
 
 
-int sequential_stability_warning(int unit_has_flipped, size_t threshold)
+size_t sequential_select_unit(hn_dynamics *dynamics, size_t max_units,
+                              int reset)
 {
-    /* Count how many consecutive updates don't result in changes */
-    static size_t stability_counter = 0;
-
-    if (unit_has_flipped) {
-        stability_counter = 0;
-    } else {
-        ++stability_counter;
-    }
-    
-    Logger("stability_counter = %lu\n", stability_counter);
-    
-    /* As soon as we have a warning, reset the counter for future use
-     * and return 1, otherwise return 0 */
-    if (stability_counter >= threshold) {
-        stability_counter = 0;
-        return 1;
-    } else {
-        return 0;
-    }
+    return sequential_select_unit_inline(dynamics, max_units, reset);
 }
 
 
-int sequential_stability_check(hn_network net, size_t max_units)
+int sequential_stability_warning(hn_dynamics *dynamics, int unit_has_flipped,
+                                 size_t threshold)
 {
-    size_t i;
+    Logger("stability_counter = %lu\n", dynamics->stability_counter);
     
-    for (i = 0; i < max_units; ++i) {
+    return sequential_stability_warning_inline(dynamics, unit_has_flipped,
+                                               threshold);
+}
 
-        /* Compute the local field */
-        double local_field = 0.;
-        for (size_t j = 0; j < max_units; ++j) {
-            local_field += net.weights[i][j] * net.activations[j];
-        }
-        
-        /* Check if the unit is stable, i.e., the activation doesn't change */
-        if (Sign(local_field - net.threshold) != net.activations[i]) {
-            return 0;
-        }
-    }
-    
-    Logger("Last verified index (MODE_SEQUENTIAL): %lu\n", i);
+
+int sequential_stability_check(const hn_dynamics *dynamics, size_t max_units)
+{
+    Logger("Unstable units (MODE_SEQUENTIAL): %lu\n", dynamics->unstable_units);
     
-    return 1;
+    return dynamics->unstable_units == 0;
 }
 
 
-size_t random_select_unit(size_t max_units, int reset)
+size_t random_select_unit(hn_dynamics *dynamics, size_t max_units,
+                          int reset)
 {
-    /* (The reset argument is unused) */
-    return RandI(max_units);
+    return random_select_unit_inline(dynamics, max_units, reset);
 }
 
 
-int random_stability_check(hn_network net, size_t max_units)
+int random_stability_check(const hn_dynamics *dynamics, size_t max_units)
 {
-    size_t i;    
+    Logger("Unstable units (MODE_RANDOM): %lu\n", dynamics->unstable_units);
 
-    for (i = 0; i < max_units; ++i) {
+    return dynamics->unstable_units == 0;
+}
+
+
+size_t worklist_select_unit(hn_dynamics *dynamics, size_t max_units,
+                            int reset)
+{
+    return worklist_select_unit_inline(dynamics, max_units, reset);
+}
 
-        /* Compute the local field */
-        double local_field = 0.;
-        for (size_t j = 0; j < max_units; ++j) {
-            local_field += net.weights[i][j] * net.activations[j];
-        }
-        
-        /* Check if the unit is stable, i.e., activation doesn't change */
-        if (Sign(local_field - net.threshold) != net.activations[i]) {
-            return 0;
-        }
-    }
-    
-    Logger("Last verified index (MODE_RANDOM): %lu\n", i);
 
+int worklist_stability_warning(hn_dynamics *dynamics, int unit_has_flipped,
+                               size_t threshold)
+{
+    /* Every update flips a unit: there is no streak of stable updates
+     * to wait for, and the check is O(1) anyway */
     return 1;
 }
+
+
+int worklist_stability_check(const hn_dynamics *dynamics, size_t max_units)
+{
+    Logger("Unstable units (MODE_WORKLIST): %lu\n", dynamics->unstable_units);
+
+    return dynamics->unstable_units == 0;
+}
+
+
+size_t greedy_select_unit(hn_dynamics *dynamics, size_t max_units,
+                          int reset)
+{
+    return greedy_select_unit_inline(dynamics, max_units, reset);
+}
+
+
+size_t permutation_select_unit(hn_dynamics *dynamics, size_t max_units,
+                               int reset)
+{
+    return permutation_select_unit_inline(dynamics, max_units, reset);
+}
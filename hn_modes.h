@@ -21,6 +21,7 @@
 #define HN_MODES_H
 
 
+#include "hn_rng.h"
 #include "hn_types.h"
 
 #include <stdlib.h>
@@ -46,12 +47,15 @@ hn_mode_utils hn_utils_with_mode(enum hn_mode mode);
 /**
  * At each call, generate the next index (wrap around after max_units).
  * 
+ * \param dynamics     the state of the recall in progress, holding the
+ *                     position in the sweep
  * \param max_units    the size of the network
- * \param reset        a reset signal: static counter is set to 0 iff reset = 1
+ * \param reset        a reset signal: the position is set to 0 iff reset = 1
  * 
  * \return             the index of the unit to update
  */
-size_t sequential_select_unit(size_t max_units, int reset);
+size_t sequential_select_unit(hn_dynamics *dynamics, size_t max_units,
+                              int reset);
 
 
 /**
@@ -59,46 +63,241 @@ size_t sequential_select_unit(size_t max_units, int reset);
  * consecutive stable updates (no change in activation) has reached a
  * threshold.
  * 
- * \param unit_has_flipped    the size of the network
- * \param threshold           the size of the network
+ * \param dynamics            the state of the recall in progress, holding
+ *                            the counter of stable updates
+ * \param unit_has_flipped    whether the last update flipped the unit
+ * \param threshold           the number of stable updates that triggers
+ *                            the warning
  * 
  * \return                    1 if warning is issued, 0 otherwise
  */
-int sequential_stability_warning(int unit_has_flipped, size_t threshold);
+int sequential_stability_warning(hn_dynamics *dynamics, int unit_has_flipped,
+                                 size_t threshold);
 
 
 /**
- * Checks whether all units are stable.
+ * Checks whether all units are stable, from the count of unstable units
+ * kept up to date by the dynamics.
  * 
- * \param net          the Hopfield Network data-structure
+ * \param dynamics     the state of the recall in progress
  * \param max_units    the size of the network
  * 
  * \return             1 if the test is successful, 0 otherwise
  */
-int sequential_stability_check(hn_network net, size_t max_units);
+int sequential_stability_check(const hn_dynamics *dynamics, size_t max_units);
 
 
 /**
  * At each call, generate the next index uniformly at random.
  * 
+ * \param dynamics     the state of the recall in progress, whose generator
+ *                     is used
  * \param max_units    the size of the network
- * \param reset        (no effect)
+ * \param reset        if 1, just return 0 (nothing to reset)
  * 
  * \return             the index of the unit to update
  */
-size_t random_select_unit(size_t max_units, int reset);
+size_t random_select_unit(hn_dynamics *dynamics, size_t max_units,
+                          int reset);
 
 
 /**
  * Checks whether all units are stable (duplicate of
  * sequential_stability_check()).
  * 
- * \param net          the Hopfield Network data-structure
+ * \param dynamics     the state of the recall in progress
  * \param max_units    the size of the network
  * 
  * \return             1 if the test is successful, 0 otherwise
  */
-int random_stability_check(hn_network, size_t max_units);
+int random_stability_check(const hn_dynamics *dynamics, size_t max_units);
+
+
+/**
+ * At each call, draw a unit uniformly at random among the unstable ones,
+ * listed by the dynamics (MODE_WORKLIST): every update flips a unit.
+ * 
+ * \param dynamics     the state of the recall in progress, whose generator
+ *                     is used
+ * \param max_units    the size of the network
+ * \param reset        if 1, just return 0 (nothing to reset)
+ * 
+ * \return             the index of the unit to update
+ */
+size_t worklist_select_unit(hn_dynamics *dynamics, size_t max_units,
+                            int reset);
+
+
+/**
+ * At each call, select the unit whose local field most strongly disagrees
+ * with its activation (MODE_GREEDY), i.e., the top of the heap kept by
+ * the dynamics: the steepest descent of the energy.
+ * 
+ * \param dynamics     the state of the recall in progress
+ * \param max_units    the size of the network
+ * \param reset        if 1, just return 0 (nothing to reset)
+ * 
+ * \return             the index of the unit to update
+ */
+size_t greedy_select_unit(hn_dynamics *dynamics, size_t max_units,
+                          int reset);
+
+
+/**
+ * At each call, generate the next index of a sweep that visits every unit
+ * once, in the order of a permutation shuffled afresh at every sweep
+ * (MODE_RANDOM_PERMUTATION).
+ * 
+ * \param dynamics     the state of the recall in progress, whose generator
+ *                     and permutation are used
+ * \param max_units    the size of the network
+ * \param reset        if 1, start a new sweep at the next call
+ * 
+ * \return             the index of the unit to update
+ */
+size_t permutation_select_unit(hn_dynamics *dynamics, size_t max_units,
+                               int reset);
+
+
+/**
+ * Always issue the warning: as every update does some work, the (O(1))
+ * stability check is performed after each of them.
+ * 
+ * \param dynamics            (no effect)
+ * \param unit_has_flipped    whether the last update flipped the unit
+ * \param threshold           (no effect)
+ * 
+ * \return                    1
+ */
+int worklist_stability_warning(hn_dynamics *dynamics, int unit_has_flipped,
+                               size_t threshold);
+
+
+/**
+ * Checks whether all units are stable, i.e., the worklist is empty.
+ * 
+ * \param dynamics     the state of the recall in progress
+ * \param max_units    the size of the network
+ * 
+ * \return             1 if the test is successful, 0 otherwise
+ */
+int worklist_stability_check(const hn_dynamics *dynamics, size_t max_units);
+
+
+/**
+ * Whether the functions of a utility package are those that
+ * hn_utils_with_mode() gives for its mode: the recalls can then use
+ * their inline versions below (or other equivalent loops) instead of
+ * calling them.
+ * 
+ * \param utils   the utility package
+ * 
+ * \return        1 if the package is standard, 0 otherwise
+ */
+int hn_utils_are_standard(hn_mode_utils utils);
+
+
+
+/*
+ * Inline versions of the utilities above, for the recall loops
+ * specialised by mode: the functions above are wrappers around them, so
+ * there is one copy of the logic. All the stability checks are
+ * dynamics->unstable_units == 0.
+ */
+
+
+static inline size_t sequential_select_unit_inline(hn_dynamics *dynamics,
+                                                   size_t max_units,
+                                                   int reset)
+{
+    if (reset) {
+        return (dynamics->selector_position = 0);
+    } else {
+        size_t unit = dynamics->selector_position++;
+        if (dynamics->selector_position == max_units) {
+            dynamics->selector_position = 0;
+        }
+        return unit;
+    }
+}
+
+
+static inline size_t random_select_unit_inline(hn_dynamics *dynamics,
+                                               size_t max_units, int reset)
+{
+    /* (The generator is seeded with the recall state: nothing to reset) */
+    if (reset) {
+        return 0;
+    }
+    return hn_rng_bounded(&dynamics->rng, max_units);
+}
+
+
+static inline size_t worklist_select_unit_inline(hn_dynamics *dynamics,
+                                                 size_t max_units,
+                                                 int reset)
+{
+    /* Nothing to draw from when resetting (or if already stable) */
+    if (reset || dynamics->unstable_units == 0) {
+        return 0;
+    }
+    return dynamics->worklist[hn_rng_bounded(&dynamics->rng,
+                                             dynamics->unstable_units)];
+}
+
+
+static inline size_t greedy_select_unit_inline(hn_dynamics *dynamics,
+                                               size_t max_units, int reset)
+{
+    /* (The top of the heap is always the most unstable unit) */
+    if (reset) {
+        return 0;
+    }
+    return dynamics->heap[0];
+}
+
+
+static inline size_t permutation_select_unit_inline(hn_dynamics *dynamics,
+                                                    size_t max_units,
+                                                    int reset)
+{
+    /* The first call after the reset starts a new sweep (shuffling the
+     * identity, so that the recall doesn't depend on earlier ones) */
+    if (reset) {
+        for (size_t i = 0; i < max_units; ++i) {
+            dynamics->permutation[i] = i;
+        }
+        dynamics->selector_position = max_units;
+        return 0;
+    }
+    if (dynamics->selector_position >= max_units) {
+        hn_rng_shuffle(&dynamics->rng, dynamics->permutation, max_units);
+        dynamics->selector_position = 0;
+    }
+    return dynamics->permutation[dynamics->selector_position++];
+}
+
+
+static inline int sequential_stability_warning_inline(hn_dynamics *dynamics,
+                                                      int unit_has_flipped,
+                                                      size_t threshold)
+{
+    /* Count how many consecutive updates don't result in changes */
+    if (unit_has_flipped) {
+        dynamics->stability_counter = 0;
+    } else {
+        ++dynamics->stability_counter;
+    }
+    
+    /* As soon as we have a warning, reset the counter for future use
+     * and return 1, otherwise return 0 */
+    if (dynamics->stability_counter >= threshold) {
+        dynamics->stability_counter = 0;
+        return 1;
+    } else {
+        return 0;
+    }
+}
 
 
 #endif  /* HN_MODES_H */
@@ -14,14 +14,38 @@
 
 
 #include "debug_log.h"
+#include "hn_bitpack.h"
+#include "hn_kernels.h"
 #include "hn_macro_utils.h"
+#include "hn_modes.h"
 #include "hn_network.h"
+#include "hn_rng.h"
+#include "hn_small.h"
 #include "hn_types.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 
+/* Rounds of concurrent sweeps before MODE_PARALLEL gives up and lets
+ * the sequential dynamics finish (simultaneous updates of coupled units
+ * may, in principle, keep oscillating) */
+#define MAX_PARALLEL_ROUNDS 100
+
+/* The Glauber acceptance probability 1 / (1 + exp(-2x)) is tabulated at
+ * GLAUBER_TABLE_SIZE + 1 points for -GLAUBER_RANGE <= x <= GLAUBER_RANGE
+ * and linearly interpolated (error < 1e-5); beyond the range it is
+ * rounded to 0 or 1 (error < 3e-9) */
+#define GLAUBER_TABLE_SIZE 1024
+#define GLAUBER_RANGE 10.
+
+/* A pattern whose residual from the span of the learnt ones has squared
+ * norm below PROJECTION_TOLERANCE * max_units (out of max_units for the
+ * pattern itself) is taken to lie in the span already */
+#define PROJECTION_TOLERANCE 1e-9
+
+
 /* The following is only needed to visualize activation arrays for debugging */
 #ifdef DEBUG_LOG
 
@@ -41,32 +65,866 @@ void print_arr(spike_T *arr, size_t length)
 
 
 
+/**
+ * Compute the local fields of all the units from scratch, in the units
+ * of the cached fields (one matrix-vector product, multithreaded).
+ *
+ * @param local_fields: the fields to be filled (max_units long)
+ * @param network:      the Hopfield Network data structure
+ * @param max_units:    the size of the network
+ */
+static void hn_all_fields(double *local_fields, hn_network net,
+                          size_t max_units)
+{
+    switch (net.format) {
+    case WEIGHTS_COUNTS:
+        hn_count_local_fields(local_fields, net.counts.counts,
+                              net.activations, max_units);
+        break;
+    case WEIGHTS_PACKED:
+#       pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < max_units; ++i) {
+            local_fields[i] = hn_packed_local_field(net.packed_weights, i,
+                                                    net.activations, max_units);
+        }
+        break;
+    case WEIGHTS_SPARSE:
+#       pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < max_units; ++i) {
+            size_t start = net.sparse.row_starts[i];
+            size_t length = net.sparse.row_starts[i + 1] - start;
+            local_fields[i] = hn_sparse_local_field(net.sparse.values + start,
+                                                    net.sparse.columns + start,
+                                                    length, net.activations);
+        }
+        break;
+    case WEIGHTS_DENSE:
+    default:
+        hn_local_fields(local_fields, net.weights, net.activations,
+                        max_units);
+        break;
+    }
+}
+
+
+/**
+ * Same as hn_all_fields() for several states of the network at once
+ * (one matrix-matrix product, reusing each tile of the weights).
+ *
+ * @param local_fields: max_states arrays of fields to be filled
+ * @param network:      the Hopfield Network data structure
+ * @param states:       max_states states of the network
+ * @param max_states:   the number of states
+ * @param max_units:    the size of the network
+ */
+static void hn_all_fields_batch(double **local_fields, hn_network net,
+                                spike_T **states, size_t max_states,
+                                size_t max_units)
+{
+    switch (net.format) {
+    case WEIGHTS_COUNTS:
+        hn_count_local_fields_batch(local_fields, net.counts.counts, states,
+                                    max_states, max_units);
+        break;
+    case WEIGHTS_PACKED:
+    case WEIGHTS_SPARSE:
+        /* No tiling across these rows: one state at a time */
+        for (size_t k = 0; k < max_states; ++k) {
+            net.activations = states[k];
+            hn_all_fields(local_fields[k], net, max_units);
+        }
+        break;
+    case WEIGHTS_DENSE:
+    default:
+        hn_local_fields_batch(local_fields, net.weights, states, max_states,
+                              max_units);
+        break;
+    }
+}
+
+
+/**
+ * The threshold in the same units as the cached fields.
+ *
+ * @param network:      the Hopfield Network data structure
+ *
+ * @return:             the (possibly rescaled) threshold
+ */
+static double hn_field_threshold(hn_network net)
+{
+    /* Integer weights are unscaled: scale the threshold the other way */
+    if (net.format == WEIGHTS_COUNTS) {
+        return net.threshold / net.counts.scale;
+    } else {
+        return net.threshold;
+    }
+}
+
+
+/**
+ * The weight of the self-coupling of a unit (diagonal of the weights),
+ * in the same units as the cached fields.
+ *
+ * @param unit:         the index of the unit
+ * @param network:      the Hopfield Network data structure
+ * @param max_units:    the size of the network
+ *
+ * @return:             the diagonal weight (0. if absent)
+ */
+static double hn_self_coupling(size_t unit, hn_network net, size_t max_units)
+{
+    switch (net.format) {
+    case WEIGHTS_COUNTS:
+        return net.counts.counts[unit][unit];
+    case WEIGHTS_PACKED:
+        return net.packed_weights[PackedRowOffset(unit, max_units)];
+    case WEIGHTS_SPARSE: {
+        /* Binary search among the (sorted) columns of the row */
+        size_t low = net.sparse.row_starts[unit];
+        size_t high = net.sparse.row_starts[unit + 1];
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (net.sparse.columns[middle] < unit) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < net.sparse.row_starts[unit + 1] &&
+            net.sparse.columns[low] == unit) {
+            return net.sparse.values[low];
+        }
+        return 0.;
+    }
+    case WEIGHTS_DENSE:
+    default:
+        return net.weights[unit][unit];
+    }
+}
+
+
+/**
+ * The energy -1/2 s^T W s + threshold * sum_i s_i of the current state,
+ * from its local fields (all in the same units).
+ *
+ * @param local_fields: the local fields of the current state
+ * @param activations:  the current state
+ * @param threshold:    the threshold, in the same units as the fields
+ * @param max_units:    the size of the network
+ *
+ * @return:             the energy
+ */
+static double hn_energy_from_fields(double *local_fields, spike_T *activations,
+                                    double threshold, size_t max_units)
+{
+    double energy = 0.;
+    for (size_t i = 0; i < max_units; ++i) {
+        energy += activations[i] * (threshold - 0.5 * local_fields[i]);
+    }
+    return energy;
+}
+
+
+/* Append the current energy (rescaled for integer weights) to the trace */
+static void hn_energy_record(hn_network net, hn_dynamics *dynamics)
+{
+    hn_energy_trace *trace = dynamics->trace;
+    double energy = dynamics->energy;
+    if (net.format == WEIGHTS_COUNTS) {
+        energy *= net.counts.scale;
+    }
+    
+    if (trace->energies != NULL && trace->length < trace->max_energies) {
+        trace->energies[trace->length++] = energy;
+    }
+    trace->final_energy = energy;
+}
+
+
+/**
+ * Whether unit a is more unstable than unit b: unstable units come first,
+ * then the larger violation -activation * (field - threshold).
+ *
+ * @param a, b:         the units to compare
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state
+ *
+ * @return:             1 if a must be above b in the heap, 0 otherwise
+ */
+static int hn_heap_above(size_t a, size_t b, hn_network net,
+                         const hn_dynamics *dynamics)
+{
+    double field_a = dynamics->local_fields[a];
+    double field_b = dynamics->local_fields[b];
+    int unstable_a = UnitIsUnstable(field_a, net.activations[a],
+                                    dynamics->threshold);
+    int unstable_b = UnitIsUnstable(field_b, net.activations[b],
+                                    dynamics->threshold);
+    if (unstable_a != unstable_b) {
+        return unstable_a;
+    }
+    return -net.activations[a] * (field_a - dynamics->threshold) >
+           -net.activations[b] * (field_b - dynamics->threshold);
+}
+
+
+/* Exchange two entries of the heap, keeping track of their positions */
+static void hn_heap_swap(hn_dynamics *dynamics, size_t i, size_t j)
+{
+    SwapValues(dynamics->heap[i], dynamics->heap[j], size_t);
+    dynamics->heap_positions[dynamics->heap[i]] = i;
+    dynamics->heap_positions[dynamics->heap[j]] = j;
+}
+
+
+/**
+ * Move a unit down the heap until it is above both its children.
+ *
+ * @param position:     the index in the heap of the unit
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state, with its heap
+ * @param max_units:    the size of the network
+ */
+static void hn_heap_sift_down(size_t position, hn_network net,
+                              hn_dynamics *dynamics, size_t max_units)
+{
+    size_t *heap = dynamics->heap;
+    for (;;) {
+        size_t top = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < max_units && hn_heap_above(heap[left], heap[top], net,
+                                              dynamics)) {
+            top = left;
+        }
+        if (right < max_units && hn_heap_above(heap[right], heap[top], net,
+                                               dynamics)) {
+            top = right;
+        }
+        if (top == position) {
+            return;
+        }
+        hn_heap_swap(dynamics, position, top);
+        position = top;
+    }
+}
+
+
+/**
+ * Restore the heap order around a unit whose key has changed, in
+ * O(log(max_units)).
+ *
+ * @param unit:         the unit whose field or activation has changed
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state, with its heap
+ * @param max_units:    the size of the network
+ */
+static void hn_heap_refresh(size_t unit, hn_network net,
+                            hn_dynamics *dynamics, size_t max_units)
+{
+    size_t position = dynamics->heap_positions[unit];
+    
+    /* Up first (stop at the root or below a unit that stays above) */
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!hn_heap_above(unit, dynamics->heap[parent], net, dynamics)) {
+            break;
+        }
+        hn_heap_swap(dynamics, position, parent);
+        position = parent;
+    }
+    hn_heap_sift_down(position, net, dynamics, max_units);
+}
+
+
+/**
+ * Arrange all the units in the heap, in O(max_units).
+ *
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state, with its heap allocated
+ * @param max_units:    the size of the network
+ */
+static void hn_heap_build(hn_network net, hn_dynamics *dynamics,
+                          size_t max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        dynamics->heap[i] = i;
+        dynamics->heap_positions[i] = i;
+    }
+    for (size_t i = max_units / 2; i-- > 0; ) {
+        hn_heap_sift_down(i, net, dynamics, max_units);
+    }
+}
+
+
+/**
+ * Count the units that are unstable, given the cached local fields
+ * and the threshold of the recall state.
+ *
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state (fields and threshold set)
+ * @param max_units:    the size of the network
+ */
+static void hn_count_unstable_units(hn_network net, hn_dynamics *dynamics,
+                                    size_t max_units)
+{
+    dynamics->unstable_units = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        int unstable = UnitIsUnstable(dynamics->local_fields[i],
+                                      net.activations[i], dynamics->threshold);
+        /* Rebuild the list of unstable units too, if there is one */
+        if (dynamics->worklist != NULL) {
+            dynamics->worklist_positions[i] = unstable ?
+                                              dynamics->unstable_units :
+                                              max_units;
+            if (unstable) {
+                dynamics->worklist[dynamics->unstable_units] = i;
+            }
+        }
+        dynamics->unstable_units += unstable;
+    }
+    
+    if (dynamics->heap != NULL) {
+        hn_heap_build(net, dynamics, max_units);
+    }
+}
+
+
+/**
+ * Allocate the list of unstable units (MODE_WORKLIST), the heap of all
+ * units (MODE_GREEDY) or the visiting order (MODE_RANDOM_PERMUTATION) if
+ * the update mode draws from them; the arrays that are not needed are
+ * set to NULL. The counters of the selection utilities are cleared, and
+ * the generator is seeded from rand() if the mode (or the finite
+ * temperature dynamics) draws at random.
+ *
+ * @param dynamics:     the recall state
+ * @param max_units:    the size of the network
+ * @param utils:        the update mode and schedule
+ */
+static void hn_selection_alloc(hn_dynamics *dynamics, size_t max_units,
+                               hn_mode_utils utils)
+{
+    enum hn_mode mode = utils.mode;
+    dynamics->worklist = NULL;
+    dynamics->worklist_positions = NULL;
+    dynamics->heap = NULL;
+    dynamics->heap_positions = NULL;
+    dynamics->permutation = NULL;
+    dynamics->selector_position = 0;
+    dynamics->stability_counter = 0;
+    dynamics->trace = NULL;
+    if (mode == MODE_RANDOM || mode == MODE_WORKLIST ||
+        mode == MODE_RANDOM_PERMUTATION || utils.schedule != NULL) {
+        hn_rng_seed_from_rand(&dynamics->rng);
+    }
+    if (mode == MODE_WORKLIST) {
+        dynamics->worklist = malloc(Max(max_units, 1) * sizeof (size_t));
+        dynamics->worklist_positions = malloc(Max(max_units, 1) *
+                                              sizeof (size_t));
+        KillUnless(dynamics->worklist != NULL &&
+                   dynamics->worklist_positions != NULL);
+    } else if (mode == MODE_GREEDY) {
+        dynamics->heap = malloc(Max(max_units, 1) * sizeof (size_t));
+        dynamics->heap_positions = malloc(Max(max_units, 1) * sizeof (size_t));
+        KillUnless(dynamics->heap != NULL && dynamics->heap_positions != NULL);
+    } else if (mode == MODE_RANDOM_PERMUTATION) {
+        dynamics->permutation = malloc(Max(max_units, 1) * sizeof (size_t));
+        KillUnless(dynamics->permutation != NULL);
+        for (size_t i = 0; i < max_units; ++i) {
+            dynamics->permutation[i] = i;
+        }
+    }
+}
+
+
+static void hn_selection_free(hn_dynamics *dynamics)
+{
+    free(dynamics->worklist);
+    free(dynamics->worklist_positions);
+    free(dynamics->heap);
+    free(dynamics->heap_positions);
+    free(dynamics->permutation);
+    dynamics->worklist = NULL;
+    dynamics->worklist_positions = NULL;
+    dynamics->heap = NULL;
+    dynamics->heap_positions = NULL;
+    dynamics->permutation = NULL;
+}
+
+
+/**
+ * Add a unit to the list of unstable units, or remove it (by moving the
+ * last unit of the list in its place), according to its cached field.
+ *
+ * @param unit:         the unit whose field may have changed
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state, with a list of unstable units
+ * @param listed:       the length of the list (kept up to date)
+ * @param max_units:    the size of the network
+ */
+static void hn_worklist_refresh(size_t unit, hn_network net,
+                                hn_dynamics *dynamics, size_t *listed,
+                                size_t max_units)
+{
+    int unstable = UnitIsUnstable(dynamics->local_fields[unit],
+                                  net.activations[unit], dynamics->threshold);
+    size_t position = dynamics->worklist_positions[unit];
+    
+    if (unstable && position == max_units) {
+        dynamics->worklist[*listed] = unit;
+        dynamics->worklist_positions[unit] = *listed;
+        ++*listed;
+    } else if (!unstable && position != max_units) {
+        size_t last = dynamics->worklist[--*listed];
+        dynamics->worklist[position] = last;
+        dynamics->worklist_positions[last] = position;
+        dynamics->worklist_positions[unit] = max_units;
+    }
+}
+
+
+/**
+ * Compute the local field of every unit from scratch, given the current
+ * state of the network (this is the only O(max_units^2) step of a recall),
+ * and count the units that are unstable.
+ *
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state to be filled (fields allocated)
+ * @param max_units:    the size of the network
+ */
+static void hn_init_dynamics(hn_network net, hn_dynamics *dynamics,
+                             size_t max_units)
+{
+    dynamics->threshold = hn_field_threshold(net);
+    
+    hn_all_fields(dynamics->local_fields, net, max_units);
+    
+    hn_count_unstable_units(net, dynamics, max_units);
+}
+
+
+/**
+ * Flip a unit to the given activation and propagate the change to the
+ * fields of all the units in O(max_units), reading row update_index of
+ * the (symmetric) weight matrix in place of the column; the count of
+ * unstable units (and the worklist, heap and energy, if any) are
+ * adjusted along the way.
+ *
+ * @param update_index:     the index of the unit to be flipped
+ * @param new_activation:   its new activation (opposite to the current one)
+ * @param network:          the Hopfield Network data structure
+ * @param dynamics:         the recall state (kept up to date)
+ * @param max_units:        the size of the network
+ */
+static void hn_flip(size_t update_index, spike_T new_activation,
+                    hn_network net, hn_dynamics *dynamics, size_t max_units)
+{
+    double *local_fields = dynamics->local_fields;
+    double field = local_fields[update_index];
+    
+    size_t listed = dynamics->unstable_units;
+    /* The stability of the unit itself changes first (its field hasn't
+     * changed yet): with the activation function, it has just been
+     * stabilised, while a noisy update may also destabilise it */
+    dynamics->unstable_units -= UnitIsUnstable(field,
+                                               net.activations[update_index],
+                                               dynamics->threshold);
+    dynamics->unstable_units += UnitIsUnstable(field, new_activation,
+                                               dynamics->threshold);
+    net.activations[update_index] = new_activation;
+    
+    /* The energy changes by -delta * (field - threshold) - 1/2 delta^2 w_kk,
+     * with the field before the flip */
+    if (dynamics->trace != NULL) {
+        double delta = 2. * new_activation;
+        dynamics->energy -= delta * (field - dynamics->threshold) +
+                            0.5 * delta * delta *
+                            hn_self_coupling(update_index, net, max_units);
+    }
+    
+    /* The unit went from -new_activation to new_activation */
+    long change;
+    switch (net.format) {
+    case WEIGHTS_COUNTS:
+        change = hn_count_propagate_flip(local_fields,
+                                         net.counts.counts[update_index],
+                                         2. * new_activation, net.activations,
+                                         dynamics->threshold, max_units);
+        break;
+    case WEIGHTS_PACKED:
+        change = hn_packed_propagate_flip(local_fields, net.packed_weights,
+                                          update_index, 2. * new_activation,
+                                          net.activations, dynamics->threshold,
+                                          max_units);
+        break;
+    case WEIGHTS_SPARSE: {
+        size_t start = net.sparse.row_starts[update_index];
+        size_t length = net.sparse.row_starts[update_index + 1] - start;
+        change = hn_sparse_propagate_flip(local_fields,
+                                          net.sparse.values + start,
+                                          net.sparse.columns + start, length,
+                                          2. * new_activation, net.activations,
+                                          dynamics->threshold);
+        break;
+    }
+    case WEIGHTS_DENSE:
+    default:
+        change = hn_propagate_flip(local_fields, net.weights[update_index],
+                                   2. * new_activation, net.activations,
+                                   dynamics->threshold, max_units);
+        break;
+    }
+    dynamics->unstable_units = (size_t)((long)dynamics->unstable_units + change);
+    
+    /* Only the units connected to the flipped one (and itself) may have
+     * changed their stability: with dense weights, that's all of them */
+    if (dynamics->worklist != NULL) {
+        hn_worklist_refresh(update_index, net, dynamics, &listed, max_units);
+        if (net.format == WEIGHTS_SPARSE) {
+            for (size_t k = net.sparse.row_starts[update_index];
+                 k < net.sparse.row_starts[update_index + 1]; ++k) {
+                hn_worklist_refresh(net.sparse.columns[k], net, dynamics,
+                                    &listed, max_units);
+            }
+        } else {
+            for (size_t i = 0; i < max_units; ++i) {
+                hn_worklist_refresh(i, net, dynamics, &listed, max_units);
+            }
+        }
+        KillUnless(listed == dynamics->unstable_units);
+    }
+    /* Same for the keys of the heap; when they all change, rebuilding
+     * it costs no more than the propagation */
+    if (dynamics->heap != NULL) {
+        if (net.format == WEIGHTS_SPARSE) {
+            hn_heap_refresh(update_index, net, dynamics, max_units);
+            for (size_t k = net.sparse.row_starts[update_index];
+                 k < net.sparse.row_starts[update_index + 1]; ++k) {
+                hn_heap_refresh(net.sparse.columns[k], net, dynamics,
+                                max_units);
+            }
+        } else {
+            hn_heap_build(net, dynamics, max_units);
+        }
+    }
+    if (dynamics->trace != NULL) {
+        hn_energy_record(net, dynamics);
+    }
+}
+
+
 /**
  * Perform a single update (hence asynchronously) of specific unit
- * given the current state of the network.
+ * given the current state of the network. The activation function
+ * is applied to the cached local field, so a unit that doesn't flip
+ * costs O(1); when it does flip, the change is propagated by hn_flip().
  *
  * @param update_index: the index of the unit to be updated
  * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state (kept up to date)
  * @param max_units:    the size of the network
  *
  * @return:             1 if the activation has changed, 0 otherwise
  */
-static int hn_update(size_t update_index, hn_network net, size_t max_units)
+static int hn_update(size_t update_index, hn_network net,
+                     hn_dynamics *dynamics, size_t max_units)
 {
-    /* Back up the current activation for the eventual comparison */
-    spike_T current_activation = net.activations[update_index];
+    /* Apply the activation function to the cached local field */
+    spike_T new_activation = Sign(dynamics->local_fields[update_index] -
+                                  dynamics->threshold);
+    if (new_activation == net.activations[update_index]) {
+        return 0;
+    }
+    hn_flip(update_index, new_activation, net, dynamics, max_units);
     
-    /* Compute the local field */
-    double local_field = 0.;    
-    for (size_t i = 0; i < max_units; ++i) {
-        local_field += net.weights[update_index][i] * net.activations[i];
+    return 1;
+}
+
+
+/**
+ * Tabulate the Glauber acceptance probability (see GLAUBER_TABLE_SIZE).
+ *
+ * @param table:    array of GLAUBER_TABLE_SIZE + 1 probabilities to fill
+ */
+static void hn_glauber_table(double *table)
+{
+    for (size_t k = 0; k <= GLAUBER_TABLE_SIZE; ++k) {
+        double x = GLAUBER_RANGE * (2. * k / GLAUBER_TABLE_SIZE - 1.);
+        table[k] = 1. / (1. + exp(-2. * x));
     }
+}
+
+
+/**
+ * The probability that a unit becomes +1 at inverse temperature beta,
+ * looked up in the table for x = beta * (field - threshold).
+ *
+ * @param table:    the table filled by hn_glauber_table()
+ * @param x:        the rescaled field
+ *
+ * @return:         1 / (1 + exp(-2x)), approximately
+ */
+static inline double hn_glauber_probability(const double *table, double x)
+{
+    if (x <= -GLAUBER_RANGE) {
+        return 0.;
+    }
+    if (x >= GLAUBER_RANGE) {
+        return 1.;
+    }
+    double position = (x + GLAUBER_RANGE) *
+                      (GLAUBER_TABLE_SIZE / (2. * GLAUBER_RANGE));
+    size_t k = (size_t)position;
+    double fraction = position - k;
+    return table[k] + fraction * (table[k + 1] - table[k]);
+}
+
+
+/**
+ * The finite-temperature stage of a recall: the units selected by the
+ * update mode take the Glauber rule on their cached fields, following
+ * the annealing schedule. The uniform variates of each sweep are drawn
+ * in bulk from the generator of the recall.
+ *
+ * @param network:      the Hopfield Network data structure
+ * @param dynamics:     the recall state (initialised and seeded)
+ * @param max_units:    the size of the network
+ * @param utils:        functions to be used, and the schedule
+ *
+ * @return:             the number of unit updates performed
+ */
+static long hn_anneal(hn_network net, hn_dynamics *dynamics,
+                      size_t max_units, hn_mode_utils utils)
+{
+    const hn_anneal_schedule *schedule = utils.schedule;
+    KillUnless(utils.mode == MODE_SEQUENTIAL || utils.mode == MODE_RANDOM ||
+               utils.mode == MODE_RANDOM_PERMUTATION);
+    KillUnless(schedule->initial_temperature > 0. &&
+               schedule->cooling_factor > 0.);
     
-    /* Apply the activation function and update the unit */
-    spike_T new_activation = Sign(local_field - net.threshold);
-    net.activations[update_index] = new_activation;
+    double table[GLAUBER_TABLE_SIZE + 1];
+    hn_glauber_table(table);
+    double *uniforms = malloc(Max(max_units, 1) * sizeof (double));
+    KillUnless(uniforms != NULL);
+    
+    /* The cached fields of integer weights are unscaled */
+    double field_scale = net.format == WEIGHTS_COUNTS ? net.counts.scale : 1.;
+    double temperature = schedule->initial_temperature;
+    long update_counter = 0;
+    
+    utils.select_unit(dynamics, max_units, 1);
+    for (size_t stage = 0; stage < schedule->max_stages; ++stage) {
+        double gain = field_scale / temperature;
+        /* (A long enough schedule cools until the temperature underflows:
+         * a field at the threshold would then give 0 * inf) */
+        KillUnless(temperature > 0. && isfinite(gain));
+        Logger("Annealing stage %zu: temperature = %g\n", stage, temperature);
+        
+        for (size_t sweep = 0; sweep < schedule->sweeps_per_stage; ++sweep) {
+            hn_rng_fill_uniform(&dynamics->rng, uniforms, max_units);
+            for (size_t n = 0; n < max_units; ++n) {
+                size_t unit = utils.select_unit(dynamics, max_units, 0);
+                double x = gain * (dynamics->local_fields[unit] -
+                                   dynamics->threshold);
+                spike_T new_activation =
+                    uniforms[n] < hn_glauber_probability(table, x) ? +1 : -1;
+                if (new_activation != net.activations[unit]) {
+                    hn_flip(unit, new_activation, net, dynamics, max_units);
+                }
+            }
+            update_counter += max_units;
+        }
+        temperature *= schedule->cooling_factor;
+    }
+    
+    free(uniforms);
+    return update_counter;
+}
+
+
+/**
+ * Selection with the standard utilities of a mode, called inline: once
+ * the mode is a constant, only one branch is left.
+ *
+ * @param mode:         the update mode (not synchronous or parallel)
+ * @param dynamics:     the recall state
+ * @param max_units:    the size of the network
+ * @param reset:        the reset signal of the selector
+ *
+ * @return:             the index of the unit to update
+ */
+static ALWAYS_INLINE size_t hn_select_unit(enum hn_mode mode,
+                                           hn_dynamics *dynamics,
+                                           size_t max_units, int reset)
+{
+    switch (mode) {
+    case MODE_RANDOM:
+        return random_select_unit_inline(dynamics, max_units, reset);
+    case MODE_WORKLIST:
+        return worklist_select_unit_inline(dynamics, max_units, reset);
+    case MODE_GREEDY:
+        return greedy_select_unit_inline(dynamics, max_units, reset);
+    case MODE_RANDOM_PERMUTATION:
+        return permutation_select_unit_inline(dynamics, max_units, reset);
+    case MODE_SEQUENTIAL:
+    default:
+        return sequential_select_unit_inline(dynamics, max_units, reset);
+    }
+}
+
+
+/**
+ * Body of the main loop of hn_async_recall() for the standard utilities
+ * of a mode, with no indirect call: it is generated once per mode below
+ * (HN_ASYNC_LOOP), where the mode is a constant. The modes whose
+ * updates always flip a unit check the stability after each of them.
+ *
+ * @param network:              the Hopfield Network data structure
+ * @param dynamics:             the recall state (initialised)
+ * @param max_units:            the size of the network
+ * @param warning_threshold:    stable-unit counter threshold
+ * @param mode:                 the update mode (not synchronous or parallel)
+ *
+ * @return:                     the number of unit updates until convergence
+ */
+static ALWAYS_INLINE long hn_async_loop(hn_network net, hn_dynamics *dynamics,
+                                        size_t max_units,
+                                        size_t warning_threshold,
+                                        enum hn_mode mode)
+{
+    long update_counter = 0;
+    int always_flips = mode == MODE_WORKLIST || mode == MODE_GREEDY;
+    
+    hn_select_unit(mode, dynamics, max_units, 1);
+    dynamics->stability_counter = 0;
+    
+    while (dynamics->unstable_units != 0) {
+        int unit_has_flipped;
+        do {
+            size_t index_to_update = hn_select_unit(mode, dynamics,
+                                                    max_units, 0);
+            unit_has_flipped = hn_update(index_to_update, net, dynamics,
+                                         max_units);
+            ++update_counter;
+        } while (!always_flips &&
+                 !sequential_stability_warning_inline(dynamics,
+                                                      unit_has_flipped,
+                                                      warning_threshold));
+    }
+    
+    return update_counter;
+}
+
+
+/* Definition of the main loop specialised for a mode */
+#define HN_ASYNC_LOOP(name, mode)                                           \
+static long hn_async_loop_##name(hn_network net, hn_dynamics *dynamics,     \
+                                 size_t max_units,                          \
+                                 size_t warning_threshold)                  \
+{                                                                           \
+    return hn_async_loop(net, dynamics, max_units, warning_threshold,       \
+                         (mode));                                           \
+}
+
+HN_ASYNC_LOOP(sequential, MODE_SEQUENTIAL)
+HN_ASYNC_LOOP(random, MODE_RANDOM)
+HN_ASYNC_LOOP(worklist, MODE_WORKLIST)
+HN_ASYNC_LOOP(greedy, MODE_GREEDY)
+HN_ASYNC_LOOP(permutation, MODE_RANDOM_PERMUTATION)
+
+
+/**
+ * The main loop of the asynchronous dynamics: units are selected and
+ * updated until the hard stability check tells to stop (after the
+ * finite-temperature stage, if the utilities have a schedule; without
+ * the final quench, the recall ends there). With the standard utilities
+ * of a mode, the loop specialised for it is chosen here, once; other
+ * utilities are called through their pointers at each update.
+ *
+ * @param network:              the Hopfield Network data structure
+ * @param dynamics:             the recall state (initialised)
+ * @param max_units:            the size of the network
+ * @param warning_threshold:    stable-unit counter threshold
+ * @param utils:                functions to be used, depending on update mode
+ *
+ * @return:                     the number of unit updates until convergence
+ */
+static long hn_async_recall(hn_network net, hn_dynamics *dynamics,
+                            size_t max_units, size_t warning_threshold,
+                            hn_mode_utils utils)
+{
+    long update_counter = 0;
+    
+    /* The finite-temperature stage comes first, if any */
+    if (utils.schedule != NULL) {
+        update_counter = hn_anneal(net, dynamics, max_units, utils);
+        if (!utils.schedule->quench) {
+            return update_counter;
+        }
+    }
+    
+    if (hn_utils_are_standard(utils)) {
+        switch (utils.mode) {
+        case MODE_RANDOM:
+            return update_counter +
+                   hn_async_loop_random(net, dynamics, max_units,
+                                        warning_threshold);
+        case MODE_WORKLIST:
+            return update_counter +
+                   hn_async_loop_worklist(net, dynamics, max_units,
+                                          warning_threshold);
+        case MODE_GREEDY:
+            return update_counter +
+                   hn_async_loop_greedy(net, dynamics, max_units,
+                                        warning_threshold);
+        case MODE_RANDOM_PERMUTATION:
+            return update_counter +
+                   hn_async_loop_permutation(net, dynamics, max_units,
+                                             warning_threshold);
+        case MODE_SEQUENTIAL:
+            return update_counter +
+                   hn_async_loop_sequential(net, dynamics, max_units,
+                                            warning_threshold);
+        default:
+            break;
+        }
+    }
+    
+    /* Resetting the selector before analysing a new pattern
+     * (mandatory with the sequential selector) */
+    utils.select_unit(dynamics, max_units, 1);
+    dynamics->stability_counter = 0;
     
-    return current_activation != new_activation;
+    /* Repeat updates until the hard stability check tells to stop */
+    Logger("Initiating main-test loop...\n");
+    while (!utils.stability_check(dynamics, max_units)) {
+        /* Heuristic loose (but quicker) stability check performed inside */
+	int unit_has_flipped;
+        do {
+            Logger("Current array:\n");
+            print_arr(net.activations, max_units);
+            
+            size_t index_to_update = utils.select_unit(dynamics, max_units,
+                                                       0);
+            
+            Logger("Index to update: %lu\n", index_to_update);
+            
+            unit_has_flipped = hn_update(index_to_update, net, dynamics,
+                                         max_units);
+            ++update_counter;
+            
+            Logger("Has unit flipped? %s\n\n",
+                      unit_has_flipped ? "Yes" : "No");
+            
+        } while (!utils.stability_warning(dynamics, unit_has_flipped,
+                                          warning_threshold));
+    }
+    Logger("Exiting main-test loop\n\n");
+    Logger("Final array:\n");
+    print_arr(net.activations, max_units);
+    
+    return update_counter;
 }
 
 
@@ -78,11 +936,51 @@ hn_network hn_network_from_params(double **weights, double threshold,
     network.weights = weights;
     network.threshold = threshold;
     network.activations = initial_pattern;
+    network.format = WEIGHTS_DENSE;
+    network.counts.counts = NULL;
+    network.counts.scale = 1.;
+    network.packed_weights = NULL;
+    network.sparse.values = NULL;
+    network.sparse.columns = NULL;
+    network.sparse.row_starts = NULL;
     Logger("Network data-structure successfully created\n");
     return network;
 }
 
 
+hn_network hn_network_from_counts(hn_count_weights weights, double threshold,
+                                  spike_T *initial_pattern)
+{
+    hn_network network = hn_network_from_params(NULL, threshold,
+                                                initial_pattern);
+    network.format = WEIGHTS_COUNTS;
+    network.counts = weights;
+    return network;
+}
+
+
+hn_network hn_network_from_packed(double *packed_weights, double threshold,
+                                  spike_T *initial_pattern)
+{
+    hn_network network = hn_network_from_params(NULL, threshold,
+                                                initial_pattern);
+    network.format = WEIGHTS_PACKED;
+    network.packed_weights = packed_weights;
+    return network;
+}
+
+
+hn_network hn_network_from_sparse(hn_sparse_weights weights, double threshold,
+                                  spike_T *initial_pattern)
+{
+    hn_network network = hn_network_from_params(NULL, threshold,
+                                                initial_pattern);
+    network.format = WEIGHTS_SPARSE;
+    network.sparse = weights;
+    return network;
+}
+
+
 /* The hn_network structures are intended to be automatic.
  * This function is for internal array cleanup */
 void hn_free(hn_network network)
@@ -108,45 +1006,392 @@ size_t hn_overlap_frequency(spike_T *p1, spike_T *p2, size_t max_units)
 }
 
 
-long hn_test_pattern(hn_network net, spike_T *pattern, size_t max_units,
-                     size_t warning_threshold, hn_mode_utils utils)
+long hn_test_pattern(hn_network net, spike_T *pattern, size_t max_units,
+                     size_t warning_threshold, hn_mode_utils utils)
+{
+    return hn_test_pattern_with_energy(net, pattern, max_units,
+                                       warning_threshold, utils, NULL);
+}
+
+
+long hn_test_pattern_with_energy(hn_network net, spike_T *pattern,
+                                 size_t max_units, size_t warning_threshold,
+                                 hn_mode_utils utils, hn_energy_trace *trace)
+{
+    long update_counter = 0;
+    /* At least one initial pattern must be present */
+    KillUnless(pattern != NULL || net.activations != NULL);
+    /* If pattern is specified, it overrides the network activations */
+    if (net.activations == NULL) {
+        Logger("net.activations == NULL\n");
+        net.activations = pattern;
+    }
+    if (trace != NULL) {
+        trace->length = 0;
+    }
+    
+    /* All the units at once: the selection utilities have no role, and
+     * the energy is computed from scratch at both ends */
+    if (utils.mode == MODE_SYNCHRONOUS || utils.mode == MODE_PARALLEL) {
+        KillUnless(utils.schedule == NULL);
+        if (trace != NULL) {
+            trace->initial_energy = hn_energy(net, max_units);
+        }
+        if (utils.mode == MODE_SYNCHRONOUS) {
+            update_counter = (long)max_units *
+                             hn_test_pattern_synchronous(net, NULL, max_units,
+                                                         0, NULL);
+        } else {
+            update_counter = hn_test_pattern_parallel(net, NULL, max_units,
+                                                      warning_threshold);
+        }
+        if (trace != NULL) {
+            trace->final_energy = hn_energy(net, max_units);
+            if (trace->energies != NULL && trace->max_energies >= 2) {
+                trace->energies[trace->length++] = trace->initial_energy;
+                trace->energies[trace->length++] = trace->final_energy;
+            }
+        }
+        return update_counter;
+    }
+    
+    /* Networks of 8, 16, 32 or 64 units have recalls of their own */
+    if (trace == NULL && hn_small_recall_available(net, max_units, utils)) {
+        hn_rng rng = {{0}};     /* (unused by MODE_SEQUENTIAL) */
+        if (utils.mode != MODE_SEQUENTIAL) {
+            hn_rng_seed_from_rand(&rng);
+        }
+        return hn_small_recall(net, max_units, warning_threshold, utils,
+                               &rng);
+    }
+    
+    /* Local fields (and the number of unstable units) are computed once
+     * and then maintained by hn_update */
+    hn_dynamics dynamics;
+    dynamics.local_fields = malloc(max_units * sizeof (double));
+    KillUnless(dynamics.local_fields != NULL);
+    hn_selection_alloc(&dynamics, max_units, utils);
+    hn_init_dynamics(net, &dynamics, max_units);
+    
+    /* The only O(max_units) step of the energy tracking */
+    if (trace != NULL) {
+        dynamics.trace = trace;
+        dynamics.energy = hn_energy_from_fields(dynamics.local_fields,
+                                                net.activations,
+                                                dynamics.threshold, max_units);
+        hn_energy_record(net, &dynamics);
+        trace->initial_energy = trace->final_energy;
+    }
+    
+    update_counter = hn_async_recall(net, &dynamics, max_units,
+                                     warning_threshold, utils);
+    
+    hn_selection_free(&dynamics);
+    free(dynamics.local_fields);
+    
+    return update_counter;
+}
+
+
+double hn_energy(hn_network net, size_t max_units)
+{
+    double *local_fields = malloc(Max(max_units, 1) * sizeof (double));
+    KillUnless(local_fields != NULL);
+    
+    hn_all_fields(local_fields, net, max_units);
+    double energy = hn_energy_from_fields(local_fields, net.activations,
+                                          hn_field_threshold(net), max_units);
+    if (net.format == WEIGHTS_COUNTS) {
+        energy *= net.counts.scale;
+    }
+    
+    free(local_fields);
+    return energy;
+}
+
+
+long hn_test_pattern_synchronous(hn_network net, spike_T *pattern,
+                                 size_t max_units, size_t max_sweeps,
+                                 int *has_cycled)
+{
+    long sweep_counter = 0;
+    int cycle_found = 0;
+    /* At least one initial pattern must be present */
+    KillUnless(pattern != NULL || net.activations != NULL);
+    /* If pattern is specified, it overrides the network activations */
+    if (net.activations == NULL) {
+        Logger("net.activations == NULL\n");
+        net.activations = pattern;
+    }
+    double threshold = hn_field_threshold(net);
+    double *local_fields = malloc(max_units * sizeof (double));
+    KillUnless(local_fields != NULL);
+    /* The state before the last sweep (a copy of the initial state
+     * doesn't fake a cycle: the first sweep changes it or stops) */
+    spike_T *previous_state = hn_pattern_copy(net.activations, max_units);
+    
+    Logger("Initiating synchronous main-test loop...\n");
+    while (max_sweeps == 0 || sweep_counter < max_sweeps) {
+        Logger("Current array:\n");
+        print_arr(net.activations, max_units);
+        
+        /* One matrix-vector product per sweep */
+        hn_all_fields(local_fields, net, max_units);
+        
+        size_t changes = 0;
+        size_t cycle_mismatches = 0;
+        for (size_t i = 0; i < max_units; ++i) {
+            spike_T new_activation = Sign(local_fields[i] - threshold);
+            changes += new_activation != net.activations[i];
+            cycle_mismatches += new_activation != previous_state[i];
+            previous_state[i] = net.activations[i];
+            net.activations[i] = new_activation;
+        }
+        
+        Logger("Units flipped in sweep %ld: %zu\n", sweep_counter, changes);
+        
+        if (changes == 0) {
+            break;
+        }
+        ++sweep_counter;
+        /* Back to the state of two sweeps ago: it will oscillate forever */
+        if (cycle_mismatches == 0) {
+            Logger("2-cycle detected\n");
+            cycle_found = 1;
+            break;
+        }
+    }
+    Logger("Exiting synchronous main-test loop\n\n");
+    Logger("Final array:\n");
+    print_arr(net.activations, max_units);
+    
+    if (has_cycled != NULL) {
+        *has_cycled = cycle_found;
+    }
+    
+    free(previous_state);
+    free(local_fields);
+    
+    return sweep_counter;
+}
+
+
+long hn_test_pattern_parallel(hn_network net, spike_T *pattern,
+                              size_t max_units, size_t warning_threshold)
+{
+    long update_counter = 0;
+    /* At least one initial pattern must be present */
+    KillUnless(pattern != NULL || net.activations != NULL);
+    /* If pattern is specified, it overrides the network activations */
+    if (net.activations == NULL) {
+        Logger("net.activations == NULL\n");
+        net.activations = pattern;
+    }
+    /* Only full rows are shared out (the triangle is too uneven) */
+    KillUnless(net.format == WEIGHTS_DENSE || net.format == WEIGHTS_COUNTS);
+    
+    double threshold = hn_field_threshold(net);
+    spike_T *activations = net.activations;
+    
+    /* Each thread sweeps its own block of units, reading the whole state
+     * while the others write it; a round without flips leaves the state
+     * untouched from start to end, so it is a fixed point */
+    Logger("Initiating parallel main-test loop...\n");
+    size_t flips;
+    size_t rounds = 0;
+    do {
+        flips = 0;
+#       pragma omp parallel for schedule(static) reduction(+:flips)
+        for (size_t i = 0; i < max_units; ++i) {
+            double local_field;
+            if (net.format == WEIGHTS_COUNTS) {
+                local_field = hn_count_local_field_shared(net.counts.counts[i],
+                                                          activations,
+                                                          max_units);
+            } else {
+                local_field = hn_local_field_shared(net.weights[i],
+                                                    activations, max_units);
+            }
+            spike_T new_activation = Sign(local_field - threshold);
+            /* Only this thread writes unit i */
+            if (new_activation != activations[i]) {
+                __atomic_store_n(activations + i, new_activation,
+                                 __ATOMIC_RELAXED);
+                ++flips;
+            }
+        }
+        update_counter += max_units;
+        ++rounds;
+        Logger("Units flipped in round %zu: %zu\n", rounds, flips);
+    } while (flips > 0 && rounds < MAX_PARALLEL_ROUNDS);
+    Logger("Exiting parallel main-test loop\n\n");
+    
+    /* Certify the fixed point with the exact stability check, letting
+     * the sequential dynamics finish the job if needed */
+    hn_dynamics dynamics;
+    dynamics.local_fields = malloc(max_units * sizeof (double));
+    KillUnless(dynamics.local_fields != NULL);
+    hn_selection_alloc(&dynamics, max_units,
+                       hn_utils_with_mode(MODE_SEQUENTIAL));
+    hn_init_dynamics(net, &dynamics, max_units);
+    if (dynamics.unstable_units > 0) {
+        Logger("Unstable units after the parallel rounds: %zu\n",
+               dynamics.unstable_units);
+        update_counter += hn_async_recall(net, &dynamics, max_units,
+                                          warning_threshold,
+                                          hn_utils_with_mode(MODE_SEQUENTIAL));
+    }
+    Logger("Final array:\n");
+    print_arr(net.activations, max_units);
+    
+    hn_selection_free(&dynamics);
+    free(dynamics.local_fields);
+    
+    return update_counter;
+}
+
+
+long hn_test_patterns_batch(hn_network net, spike_T **probes,
+                            size_t max_probes, size_t max_units,
+                            size_t warning_threshold, hn_mode_utils utils,
+                            long *updates)
 {
     long update_counter = 0;
-    /* At least one initial pattern must be present */
-    KillUnless(pattern != NULL || net.activations != NULL);
-    /* If pattern is specified, it overrides the network activations */
-    if (net.activations == NULL) {
-        Logger("net.activations == NULL\n");
-        net.activations = pattern;
+    KillUnless(probes != NULL);
+    /* (Finite temperature is for the asynchronous modes only) */
+    KillUnless(utils.schedule == NULL || (utils.mode != MODE_SYNCHRONOUS &&
+                                          utils.mode != MODE_PARALLEL));
+    
+    double **local_fields;
+    MatrixAlloc(local_fields, max_probes, max_units);
+    
+    /* The probes still running are kept at the front of these views
+     * (converged ones are swapped to the back) */
+    spike_T **states = malloc(Max(max_probes, 1) * sizeof (spike_T *));
+    double **fields = malloc(Max(max_probes, 1) * sizeof (double *));
+    size_t *probe_index = malloc(Max(max_probes, 1) * sizeof (size_t));
+    KillUnless(states != NULL && fields != NULL && probe_index != NULL);
+    for (size_t k = 0; k < max_probes; ++k) {
+        states[k] = probes[k];
+        fields[k] = local_fields[k];
+        probe_index[k] = k;
+        if (updates != NULL) {
+            updates[k] = 0;
+        }
     }
-    /* Resetting the selector before analysing a new pattern
-     * (mandatory with the sequential selector) */
-    utils.select_unit(max_units, 1);
     
-    /* Repeat updates until the hard stability check tells to stop */
-    Logger("Initiating main-test loop...\n");
-    while (!utils.stability_check(net, max_units)) {
-        /* Heuristic loose (but quicker) stability check performed inside */
-	int unit_has_flipped;
-        do {
-            Logger("Current array:\n");
-            print_arr(net.activations, max_units);
-            
-            size_t index_to_update = utils.select_unit(max_units, 0);
-            
-            Logger("Index to update: %lu\n", index_to_update);
-            
-            unit_has_flipped = hn_update(index_to_update, net, max_units);
-            ++update_counter;
-            
-            Logger("Has unit flipped? %s\n\n",
-                      unit_has_flipped ? "Yes" : "No");
+    if (utils.mode == MODE_PARALLEL) {
+        /* Each recall uses all the threads already */
+        for (size_t k = 0; k < max_probes; ++k) {
+            net.activations = probes[k];
+            long probe_updates = hn_test_pattern_parallel(net, NULL, max_units,
+                                                          warning_threshold);
+            if (updates != NULL) {
+                updates[k] = probe_updates;
+            }
+            update_counter += probe_updates;
+        }
+    } else if (utils.mode != MODE_SYNCHRONOUS) {
+        /* The O(max_units^2) step is done for all the probes together,
+         * then each one is updated on its own cached fields (small
+         * networks have recalls of their own, see hn_small.h) */
+        int small = hn_small_recall_available(net, max_units, utils);
+        if (!small) {
+            hn_all_fields_batch(fields, net, states, max_probes, max_units);
+        }
+        
+        /* Every recall has its own state (seeded in the order of the
+         * probes), so they can run on different threads */
+        hn_dynamics *dynamics = malloc(Max(max_probes, 1) *
+                                       sizeof (hn_dynamics));
+        KillUnless(dynamics != NULL);
+        for (size_t k = 0; k < max_probes; ++k) {
+            dynamics[k].local_fields = local_fields[k];
+            dynamics[k].threshold = hn_field_threshold(net);
+            hn_selection_alloc(&dynamics[k], max_units, utils);
+        }
+        
+#       pragma omp parallel for schedule(dynamic) reduction(+:update_counter)
+        for (size_t k = 0; k < max_probes; ++k) {
+            hn_network probe_net = net;
+            probe_net.activations = probes[k];
+            long probe_updates;
+            if (small) {
+                probe_updates = hn_small_recall(probe_net, max_units,
+                                                warning_threshold, utils,
+                                                &dynamics[k].rng);
+            } else {
+                hn_count_unstable_units(probe_net, &dynamics[k], max_units);
+                probe_updates = hn_async_recall(probe_net, &dynamics[k],
+                                                max_units, warning_threshold,
+                                                utils);
+            }
+            if (updates != NULL) {
+                updates[k] = probe_updates;
+            }
+            update_counter += probe_updates;
+        }
+        
+        for (size_t k = 0; k < max_probes; ++k) {
+            hn_selection_free(&dynamics[k]);
+        }
+        free(dynamics);
+    } else {
+        double threshold = hn_field_threshold(net);
+        /* The states before the last sweep (see hn_test_pattern_synchronous) */
+        spike_T **previous_states;
+        MatrixAlloc(previous_states, max_probes, max_units);
+        spike_T **previous = malloc(Max(max_probes, 1) * sizeof (spike_T *));
+        KillUnless(previous != NULL);
+        for (size_t k = 0; k < max_probes; ++k) {
+            memcpy(previous_states[k], probes[k], max_units * sizeof (spike_T));
+            previous[k] = previous_states[k];
+        }
+        
+        size_t max_active = max_probes;
+        while (max_active > 0) {
+            /* One matrix-matrix product per sweep, on the active probes */
+            hn_all_fields_batch(fields, net, states, max_active, max_units);
             
-        } while (!utils.stability_warning(unit_has_flipped, warning_threshold));
+            size_t k = 0;
+            while (k < max_active) {
+                size_t changes = 0;
+                size_t cycle_mismatches = 0;
+                for (size_t i = 0; i < max_units; ++i) {
+                    spike_T new_activation = Sign(fields[k][i] - threshold);
+                    changes += new_activation != states[k][i];
+                    cycle_mismatches += new_activation != previous[k][i];
+                    previous[k][i] = states[k][i];
+                    states[k][i] = new_activation;
+                }
+                if (changes > 0) {
+                    update_counter += max_units;
+                    if (updates != NULL) {
+                        updates[probe_index[k]] += max_units;
+                    }
+                }
+                /* Fixed point or 2-cycle: retire the probe */
+                if (changes == 0 || cycle_mismatches == 0) {
+                    --max_active;
+                    SwapValues(states[k], states[max_active], spike_T *);
+                    SwapValues(fields[k], fields[max_active], double *);
+                    SwapValues(previous[k], previous[max_active], spike_T *);
+                    SwapValues(probe_index[k], probe_index[max_active], size_t);
+                } else {
+                    ++k;
+                }
+            }
+            Logger("Probes still active: %zu\n", max_active);
+        }
+        
+        free(previous);
+        MatrixFree(previous_states);
     }
-    Logger("Exiting main-test loop\n\n");
-    Logger("Final array:\n");
-    print_arr(net.activations, max_units);
+    
+    free(probe_index);
+    free(fields);
+    free(states);
+    MatrixFree(local_fields);
     
     return update_counter;
 }
@@ -165,18 +1410,10 @@ void hn_hebb_weights_from_patterns(double **weights, spike_T **patterns,
                                 int max_patterns, int max_units,
                                 int remove_self_coupling)
 {
-    for (size_t i = 0; i < max_units; ++i) {
-        for (size_t j = 0; j < max_units; ++j) {
-            /* Initialise weights at 0 and, for each pattern,
-             * add its autocorrelation to the weight matrix */
-            weights[i][j] = 0.;
-            for (size_t n = 0; n < max_patterns; ++n) {
-                weights[i][j] += patterns[n][i] * patterns[n][j];
-            }
-            /* Normalise on number of units */
-            weights[i][j] /= max_units;
-        }
-    }
+    /* The sum of the autocorrelations of the patterns, normalised on
+     * number of units (a symmetric rank-max_patterns product) */
+    hn_correlation_update(weights, patterns, max_patterns, max_units,
+                          (double)max_units, 0);
     if (remove_self_coupling) {
         Logger("Weights: removing self-coupling\n");
         for (size_t i = 0; i < max_units; ++i) {
@@ -237,6 +1474,170 @@ void hn_hebb_weights_increment_with_pattern(double **weights,
 }
 
 
+void hn_hebb_weights_increment_with_patterns(double **weights,
+                                             spike_T **patterns,
+                                             int max_patterns, int max_units,
+                                             int remove_self_coupling)
+{
+    /* Add the (normalised) autocorrelations of all the patterns at once */
+    hn_correlation_update(weights, patterns, max_patterns, max_units,
+                          (double)max_units, 1);
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights[i][i] = 0.;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_storkey_weights_increment_with_pattern(double **weights,
+                                               spike_T *pattern, int max_units,
+                                               int remove_self_coupling)
+{
+    double *local_fields = malloc(Max(max_units, 1) * sizeof (double));
+    KillUnless(local_fields != NULL);
+    
+    /* All the fields h_ij of the rule follow from the fields h_i */
+    hn_local_fields(local_fields, weights, pattern, max_units);
+    hn_storkey_update(weights, pattern, local_fields, NULL, NULL, max_units,
+                      remove_self_coupling);
+    free(local_fields);
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_storkey_weights_increment_with_patterns(double **weights,
+                                                spike_T **patterns,
+                                                int max_patterns,
+                                                int max_units,
+                                                int remove_self_coupling)
+{
+    if (max_patterns <= 0) {
+        return;
+    }
+    double *buffer = malloc(2 * Max(max_units, 1) * sizeof (double));
+    KillUnless(buffer != NULL);
+    double *local_fields = buffer;
+    double *next_fields = buffer + max_units;
+    
+    /* Only the fields of the first pattern need a product of their own:
+     * each update computes those of the following pattern */
+    hn_local_fields(local_fields, weights, patterns[0], max_units);
+    for (int n = 0; n < max_patterns; ++n) {
+        int is_last = n + 1 == max_patterns;
+        hn_storkey_update(weights, patterns[n], local_fields,
+                          is_last ? NULL : patterns[n + 1],
+                          is_last ? NULL : next_fields, max_units,
+                          remove_self_coupling);
+        double *swap = local_fields;
+        local_fields = next_fields;
+        next_fields = swap;
+    }
+    free(buffer);
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_storkey_weights_from_patterns(double **weights, spike_T **patterns,
+                                      int max_patterns, int max_units,
+                                      int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            weights[i][j] = 0.;
+        }
+    }
+    hn_storkey_weights_increment_with_patterns(weights, patterns,
+                                               max_patterns, max_units,
+                                               remove_self_coupling);
+}
+
+
+void hn_projection_weights_increment_with_pattern(double **weights,
+                                                  double *projector_diagonal,
+                                                  spike_T *pattern,
+                                                  int max_units,
+                                                  int remove_self_coupling)
+{
+    /* Without it, the projection of the pattern cannot be computed */
+    KillUnless(!remove_self_coupling || projector_diagonal != NULL);
+    
+    double *residual = malloc(Max(max_units, 1) * sizeof (double));
+    KillUnless(residual != NULL);
+    
+    /* Residual of the pattern from the span of the patterns learnt so far
+     * (the weights are the projection onto it, but for the diagonal) */
+    hn_local_fields(residual, weights, pattern, max_units);
+    double squared_norm = 0.;
+    for (size_t i = 0; i < max_units; ++i) {
+        double projection = residual[i];
+        if (remove_self_coupling) {
+            projection += projector_diagonal[i] * pattern[i];
+        }
+        residual[i] = pattern[i] - projection;
+        squared_norm += residual[i] * residual[i];
+    }
+    
+    /* Greville's update: the projection onto the enlarged span */
+    if (squared_norm > PROJECTION_TOLERANCE * max_units) {
+        hn_rank_one_update(weights, residual, 1. / squared_norm, max_units);
+    } else {
+        Logger("Weights: pattern already in the span of the learnt ones\n");
+    }
+    free(residual);
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            projector_diagonal[i] += weights[i][i];
+            weights[i][i] = 0.;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+        if (projector_diagonal != NULL) {
+            for (size_t i = 0; i < max_units; ++i) {
+                projector_diagonal[i] = weights[i][i];
+            }
+        }
+    }
+}
+
+
+void hn_projection_weights_from_patterns(double **weights, spike_T **patterns,
+                                         int max_patterns, int max_units,
+                                         int remove_self_coupling)
+{
+    double *projector_diagonal = calloc(Max(max_units, 1), sizeof (double));
+    KillUnless(projector_diagonal != NULL);
+    
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            weights[i][j] = 0.;
+        }
+    }
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_projection_weights_increment_with_pattern(weights,
+                                                     projector_diagonal,
+                                                     patterns[n], max_units,
+                                                     remove_self_coupling);
+    }
+    free(projector_diagonal);
+}
+
+
 void hn_saturated_weights_increment_with_pattern(double **weights,
                                                  spike_T *pattern,
                                                  double saturation,
@@ -263,3 +1664,250 @@ void hn_saturated_weights_increment_with_pattern(double **weights,
         Logger("Weights: allowing self-coupling\n");
     }
 }
+
+
+/**
+ * The bound of the saturated counts for a saturation level of the
+ * weights: the largest count whose weight count / max_units does not
+ * exceed saturation (the same level iff saturation * max_units is an
+ * integer).
+ *
+ * @param saturation:   the positive saturation level of the weights
+ * @param max_units:    the size of the network
+ *
+ * @return:             the bound of the absolute values of the counts
+ */
+static count_T hn_saturation_bound(double saturation, int max_units)
+{
+    KillUnless(saturation > 0);
+    /* (The tolerance keeps levels such as 0.01 * 500 at 5) */
+    double bound = floor(saturation * max_units * (1. + 1e-12));
+    KillUnless(bound <= COUNT_MAX);
+    return (count_T)bound;
+}
+
+
+void hn_saturated_counts_increment_with_patterns(hn_count_weights *weights,
+                                                 spike_T **patterns,
+                                                 double saturation,
+                                                 int max_patterns,
+                                                 int max_units,
+                                                 int remove_self_coupling)
+{
+    count_T bound = hn_saturation_bound(saturation, max_units);
+    Logger("Weights: saturating the counts at %d\n", (int)bound);
+    
+    hn_saturated_count_update(weights->counts, patterns, Max(max_patterns, 0),
+                              max_units, bound);
+    weights->scale = 1. / max_units;
+    
+    /* (The diagonal plays no part in the other entries) */
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights->counts[i][i] = 0;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_saturated_counts_increment_with_pattern(hn_count_weights *weights,
+                                                spike_T *pattern,
+                                                double saturation,
+                                                int max_units,
+                                                int remove_self_coupling)
+{
+    hn_saturated_counts_increment_with_patterns(weights, &pattern, saturation,
+                                                1, max_units,
+                                                remove_self_coupling);
+}
+
+
+void hn_saturated_counts_from_patterns(hn_count_weights *weights,
+                                       spike_T **patterns, double saturation,
+                                       int max_patterns, int max_units,
+                                       int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            weights->counts[i][j] = 0;
+        }
+    }
+    hn_saturated_counts_increment_with_patterns(weights, patterns, saturation,
+                                                max_patterns, max_units,
+                                                remove_self_coupling);
+}
+
+
+void hn_hebb_counts_from_patterns(hn_count_weights *weights, spike_T **patterns,
+                                  int max_patterns, int max_units,
+                                  int remove_self_coupling)
+{
+    /* No count can exceed the number of patterns */
+    KillUnless(max_patterns <= COUNT_MAX);
+    
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            /* Count agreements minus disagreements over the patterns */
+            int count = 0;
+            for (size_t n = 0; n < max_patterns; ++n) {
+                count += patterns[n][i] * patterns[n][j];
+            }
+            weights->counts[i][j] = (count_T)count;
+        }
+    }
+    /* Normalise on number of units (once and for all) */
+    weights->scale = 1. / max_units;
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights->counts[i][i] = 0;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_hebb_weights_from_patterns_bitwise(double **weights,
+                                        spike_T **patterns, int max_patterns,
+                                        int max_units,
+                                        int remove_self_coupling)
+{
+    size_t max_words = hn_packed_length(max_patterns);
+    packed_spikes_T *unit_bits = malloc(Max(max_units * max_words, 1) *
+                                        sizeof (packed_spikes_T));
+    KillUnless(unit_bits != NULL);
+    
+    /* Each unit gets its activations in all the patterns as a bitset */
+    hn_pack_patterns_transposed(unit_bits, patterns, max_patterns, max_units);
+    hn_bitset_correlation_update(weights, NULL, unit_bits, max_patterns,
+                                 max_units, (double)max_units);
+    free(unit_bits);
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights[i][i] = 0.;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_hebb_counts_from_patterns_bitwise(hn_count_weights *weights,
+                                          spike_T **patterns,
+                                          int max_patterns, int max_units,
+                                          int remove_self_coupling)
+{
+    /* No count can exceed the number of patterns */
+    KillUnless(max_patterns <= COUNT_MAX);
+    
+    size_t max_words = hn_packed_length(max_patterns);
+    packed_spikes_T *unit_bits = malloc(Max(max_units * max_words, 1) *
+                                        sizeof (packed_spikes_T));
+    KillUnless(unit_bits != NULL);
+    
+    hn_pack_patterns_transposed(unit_bits, patterns, max_patterns, max_units);
+    hn_bitset_correlation_update(NULL, weights->counts, unit_bits,
+                                 max_patterns, max_units, 1.);
+    free(unit_bits);
+    /* Normalise on number of units (once and for all) */
+    weights->scale = 1. / max_units;
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights->counts[i][i] = 0;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_hebb_counts_increment_with_pattern(hn_count_weights *weights,
+                                           spike_T *pattern, size_t max_units,
+                                           int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        count_T *counts_row = weights->counts[i];
+        for (size_t j = 0; j < max_units; ++j) {
+            /* A count at COUNT_MAX would wrap around (more than COUNT_MAX
+             * patterns learnt) */
+            KillUnless(abs(counts_row[j]) < COUNT_MAX);
+            /* Add pattern autocorrelation to the counts */
+            counts_row[j] += pattern[i] * pattern[j];
+        }
+    }
+    weights->scale = 1. / max_units;
+    
+    if (remove_self_coupling) {
+        Logger("Weights: removing self-coupling\n");
+        for (size_t i = 0; i < max_units; ++i) {
+            weights->counts[i][i] = 0;
+        }
+    } else {
+        Logger("Weights: keeping self-coupling\n");
+    }
+}
+
+
+void hn_pack_weights(double *packed_weights, double **weights,
+                     size_t max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        memcpy(packed_weights + PackedRowOffset(i, max_units), weights[i] + i,
+               (max_units - i) * sizeof (double));
+    }
+}
+
+
+void hn_hebb_packed_weights_from_patterns(double *weights, spike_T **patterns,
+                                          int max_patterns, int max_units,
+                                          int remove_self_coupling)
+{
+    double *weights_row = weights;
+    for (size_t i = 0; i < max_units; ++i) {
+        /* Only the entries j >= i of row i are computed and stored */
+        for (size_t j = i; j < max_units; ++j) {
+            int count = 0;
+            for (size_t n = 0; n < max_patterns; ++n) {
+                count += patterns[n][i] * patterns[n][j];
+            }
+            /* Normalise on number of units */
+            weights_row[j - i] = (double)count / max_units;
+        }
+        if (remove_self_coupling) {
+            weights_row[0] = 0.;
+        }
+        weights_row += max_units - i;
+    }
+    Logger("Weights: %s self-coupling\n",
+           remove_self_coupling ? "removing" : "keeping");
+}
+
+
+void hn_hebb_packed_weights_increment_with_pattern(double *weights,
+                                                   spike_T *pattern,
+                                                   int max_units,
+                                                   int remove_self_coupling)
+{
+    double *weights_row = weights;
+    for (size_t i = 0; i < max_units; ++i) {
+        /* Add (normalised) pattern autocorrelation to the upper triangle */
+        for (size_t j = i; j < max_units; ++j) {
+            weights_row[j - i] += pattern[i] * pattern[j] / (double)max_units;
+        }
+        if (remove_self_coupling) {
+            weights_row[0] = 0.;
+        }
+        weights_row += max_units - i;
+    }
+    Logger("Weights: %s self-coupling\n",
+           remove_self_coupling ? "removing" : "keeping");
+}
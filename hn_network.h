@@ -41,6 +41,55 @@ hn_network hn_network_from_params(double **weights, double threshold,
                                   spike_T *initial_state);
 
 
+/**
+ * Create the network data-structure with integer weights: the recall
+ * accumulates the local fields exactly, in integer units.
+ *
+ * \param weights         max_units * max_units symmetric count matrix
+ *                         and its scale
+ * \param threshold       the threshold of the activation function
+ * \param initial_state   initial stimulus for memory recall (max_units array)
+ *
+ * \return                the structure representing the Hopfield Network
+ *
+ */
+hn_network hn_network_from_counts(hn_count_weights weights, double threshold,
+                                  spike_T *initial_state);
+
+
+/**
+ * Create the network data-structure with weights in packed
+ * upper-triangular storage (half the memory of a full matrix).
+ *
+ * \param packed_weights  PackedMatrixLength(max_units) array holding
+ *                         the upper triangle of the symmetric matrix
+ *                         row by row (see PackedRowOffset)
+ * \param threshold       the threshold of the activation function
+ * \param initial_state   initial stimulus for memory recall (max_units array)
+ *
+ * \return                the structure representing the Hopfield Network
+ *
+ */
+hn_network hn_network_from_packed(double *packed_weights, double threshold,
+                                  spike_T *initial_state);
+
+
+/**
+ * Create the network data-structure with weights in CSR format
+ * (see hn_sparse.h): fields and updates only visit the synapses
+ * that exist.
+ *
+ * \param weights         CSR weight matrix with symmetric pattern
+ * \param threshold       the threshold of the activation function
+ * \param initial_state   initial stimulus for memory recall (max_units array)
+ *
+ * \return                the structure representing the Hopfield Network
+ *
+ */
+hn_network hn_network_from_sparse(hn_sparse_weights weights, double threshold,
+                                  spike_T *initial_state);
+
+
 /**
  * Free the allocated arrays in the Hopfield Network data-structure
  * (could be confusing. It's better to deallocate hn_network.weights and
@@ -69,7 +118,14 @@ size_t hn_overlap_frequency(spike_T *p1, spike_T *p2, size_t max_units);
  * Simulate the system dynamics, through continuous asynchronous updates
  * of the state, stop at convergence and return the number of performed updates
  * (which may be zero, because the check for convergence is done at the outset
- * of the main loop).
+ * of the main loop). The local fields are cached for the whole recall,
+ * so only updates that flip a unit cost O(max_units); this relies on
+ * the weight matrix being symmetric. If utils.schedule is set, the units
+ * are first updated with the finite-temperature (Glauber) rule, on the
+ * same cached fields, as the schedule prescribes; unless it asks for a
+ * final quench, the recall ends in that (noisy) state, which is not
+ * necessarily stable. All the state of the recall is local
+ * to the call, so recalls on different activations can run concurrently.
  *
  * \param network           the Hopfield Network data structure
  * \param pattern           the initial pattern that we want to test
@@ -84,6 +140,120 @@ long hn_test_pattern(hn_network net, spike_T *pattern, size_t max_units,
                      size_t warning_threshold, hn_mode_utils utils);
 
 
+/**
+ * Same as hn_test_pattern(), also tracking the Lyapunov energy
+ * E = -1/2 s^T W s + threshold * sum_i s_i of the state. With the
+ * asynchronous modes the energy is computed from the cached fields at the
+ * start (O(max_units)), then updated in O(1) at each flip and recorded in
+ * the trace; with MODE_SYNCHRONOUS and MODE_PARALLEL it is computed from
+ * scratch at both ends only.
+ *
+ * \param network           the Hopfield Network data structure
+ * \param pattern           the initial pattern that we want to test
+ * \param max_units         the size of the network
+ * \param warning_threshold stable-unit counter threshold
+ * \param utils             functions to be used, depending on update mode
+ * \param trace             the record to be filled (if NULL, this is
+ *                          hn_test_pattern())
+ *
+ * \return                  the number of unit updates until convergence
+ *
+ */
+long hn_test_pattern_with_energy(hn_network net, spike_T *pattern,
+                                 size_t max_units, size_t warning_threshold,
+                                 hn_mode_utils utils, hn_energy_trace *trace);
+
+
+/**
+ * Compute the energy E = -1/2 s^T W s + threshold * sum_i s_i of the
+ * current state of the network from scratch (one matrix-vector product).
+ *
+ * \param network      the Hopfield Network data structure
+ * \param max_units    the size of the network
+ *
+ * \return             the energy
+ *
+ */
+double hn_energy(hn_network net, size_t max_units);
+
+
+/**
+ * Simulate the synchronous (Little) dynamics: at each sweep all the units
+ * are updated at once, from the local fields of the previous state
+ * (a single, multithreaded, matrix-vector product). With symmetric weights
+ * the dynamics ends either at a fixed point or in a 2-cycle, which is
+ * detected by comparing each new state with the one two sweeps before.
+ * hn_test_pattern() calls this when utils.mode is MODE_SYNCHRONOUS,
+ * counting max_units updates per sweep.
+ *
+ * \param network           the Hopfield Network data structure
+ * \param pattern           the initial pattern that we want to test
+ * \param max_units         the size of the network
+ * \param max_sweeps        maximum number of sweeps (0 for no limit)
+ * \param has_cycled        if not NULL, set to 1 if the dynamics ended in a
+ *                          2-cycle (the state is then the last of the two)
+ *                          and to 0 otherwise
+ *
+ * \return                  the number of sweeps that changed the state
+ *
+ */
+long hn_test_pattern_synchronous(hn_network net, spike_T *pattern,
+                                 size_t max_units, size_t max_sweeps,
+                                 int *has_cycled);
+
+
+/**
+ * Simulate the asynchronous dynamics with several (OpenMP) threads: the
+ * units are shared out in contiguous blocks, and each thread sweeps its
+ * own block over and over, computing the local fields from the state
+ * that the other threads are updating at the same time (with relaxed
+ * atomics), until a whole round passes without flips. The final state is
+ * then certified by an exact stability check (if a rare oscillation of
+ * simultaneous updates prevented convergence, the sequential dynamics
+ * completes the recall). hn_test_pattern() calls this when utils.mode is
+ * MODE_PARALLEL. Only dense and count weights are supported.
+ *
+ * \param network           the Hopfield Network data structure
+ * \param pattern           the initial pattern that we want to test
+ * \param max_units         the size of the network
+ * \param warning_threshold stable-unit counter threshold (for the
+ *                          sequential completion)
+ *
+ * \return                  the number of unit updates (max_units per round)
+ *
+ */
+long hn_test_pattern_parallel(hn_network net, spike_T *pattern,
+                              size_t max_units, size_t warning_threshold);
+
+
+/**
+ * Run the recall of several probes on the same network, with the same
+ * results as hn_test_pattern() on each of them in turn. The local fields
+ * of all the probes are computed together, so that each tile of the
+ * weights is reused by every probe; with MODE_SYNCHRONOUS every sweep is
+ * such a product, over the probes that haven't converged yet (or ended in
+ * a 2-cycle); the asynchronous recalls of the probes are shared among
+ * OpenMP threads. net.activations is ignored.
+ *
+ * \param network           the Hopfield Network data structure
+ * \param probes            max_probes initial patterns (overwritten
+ *                          with the final states)
+ * \param max_probes        the number of probes
+ * \param max_units         the size of the network
+ * \param warning_threshold stable-unit counter threshold
+ * \param utils             functions to be used, depending on update mode
+ * \param updates           if not NULL, max_probes array filled with the
+ *                          number of unit updates of each probe
+ *
+ * \return                  the total number of unit updates
+ *
+ */
+long hn_test_patterns_batch(hn_network net, spike_T **probes,
+                            size_t max_probes, size_t max_units,
+                            size_t warning_threshold, hn_mode_utils utils,
+                            long *updates);
+
+
 /**
  * Copy a pattern vector.
  * 
@@ -98,7 +268,9 @@ spike_T *hn_pattern_copy(spike_T *pattern, size_t max_units);
 /**
  * Create a weight matrix using Hebb's rule on a list of patterns;
  * the weight matrix is expected to be pre-allocated with
- * dimensions max_units * max_units.
+ * dimensions max_units * max_units. Only the upper triangle is computed,
+ * as a cache-blocked product split among OpenMP threads (see
+ * hn_correlation_update() in hn_kernels.h), and then mirrored.
  *
  * \param weights              the weight matrix to be filled
  * \param patterns             list of spike_T patterns
@@ -128,6 +300,254 @@ void hn_hebb_weights_increment_with_pattern(double **weights,
                                             int remove_self_coupling);
 
 
+/**
+ * Add the autocorrelations of several patterns at once to the matrix
+ * weights, which must be symmetric (as Hebbian weights are); the
+ * diagonal is suppressed iff remove_self_coupling is non-zero. Same as
+ * hn_hebb_weights_increment_with_pattern() on each pattern in turn, up
+ * to rounding (exactly the same if max_units is a power of 2), with the
+ * blocked multithreaded product of hn_hebb_weights_from_patterns().
+ *
+ * \param weights              the weight matrix to be updated
+ * \param patterns             list of spike_T patterns to be learnt
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_hebb_weights_increment_with_patterns(double **weights,
+                                             spike_T **patterns,
+                                             int max_patterns, int max_units,
+                                             int remove_self_coupling);
+
+
+/**
+ * Learn a pattern with the Storkey rule (A. J. Storkey, 1997), whose
+ * capacity exceeds the 0.14 * max_units patterns of the Hebb rule:
+ *     w_ij += (x_i x_j - x_i h_ji - h_ij x_j) / max_units,
+ * where h_ij = sum_{k != i,j} w_ik x_k are computed from the local fields
+ * of the pattern, in O(max_units^2) overall (vectorised and multithreaded,
+ * see hn_storkey_update() in hn_kernels.h). The weights must be
+ * symmetric, and stay exactly so; the diagonal is suppressed iff
+ * remove_self_coupling is non-zero (otherwise h_ii = sum_{k != i} w_ik x_k).
+ *
+ * \param weights              the weight matrix to be updated
+ * \param pattern              the pattern to be learnt
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_storkey_weights_increment_with_pattern(double **weights,
+                                               spike_T *pattern, int max_units,
+                                               int remove_self_coupling);
+
+
+/**
+ * Learn several patterns, in order, with the Storkey rule: the same as
+ * hn_storkey_weights_increment_with_pattern() on each pattern in turn
+ * (up to rounding), but the local fields of each pattern are computed
+ * while the weights are updated with the previous one, so that the
+ * matrix is swept once per pattern.
+ *
+ * \param weights              the weight matrix to be updated
+ * \param patterns             list of spike_T patterns to be learnt
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_storkey_weights_increment_with_patterns(double **weights,
+                                                spike_T **patterns,
+                                                int max_patterns,
+                                                int max_units,
+                                                int remove_self_coupling);
+
+
+/**
+ * Storkey weights of a list of patterns, learnt in order starting from
+ * zero weights (see hn_storkey_weights_increment_with_patterns()); the
+ * matrix is expected to be pre-allocated with dimensions
+ * max_units * max_units.
+ *
+ * \param weights              the weight matrix to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_storkey_weights_from_patterns(double **weights, spike_T **patterns,
+                                      int max_patterns, int max_units,
+                                      int remove_self_coupling);
+
+
+/**
+ * Learn a pattern with the projection (pseudo-inverse) rule: the weights
+ * become the orthogonal projection onto the span of the patterns learnt
+ * so far, (1/max_units) X C^-1 X^T with C the correlation matrix of the
+ * patterns (the columns of X), so that every linearly independent set
+ * of patterns is stored. C is never formed: the projection is enlarged
+ * with Greville's rank-one update by the residual r = x - P x of the
+ * pattern, P += r r^T / |r|^2, in O(max_units^2) (a pattern already in
+ * the span leaves it unchanged). The weights stay exactly symmetric.
+ * Since the diagonal of the projection is needed for the residual, it is
+ * kept in projector_diagonal, which is required iff remove_self_coupling
+ * is non-zero (and kept up to date if given otherwise).
+ *
+ * \param weights              the weight matrix to be updated (zero before
+ *                             the first pattern)
+ * \param projector_diagonal   the diagonal of the projection (max_units
+ *                             long, zero before the first pattern), or NULL
+ *                             if remove_self_coupling is 0
+ * \param pattern              the pattern to be learnt
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_projection_weights_increment_with_pattern(double **weights,
+                                                  double *projector_diagonal,
+                                                  spike_T *pattern,
+                                                  int max_units,
+                                                  int remove_self_coupling);
+
+
+/**
+ * Projection weights of a list of patterns (see
+ * hn_projection_weights_increment_with_pattern()); the matrix is expected
+ * to be pre-allocated with dimensions max_units * max_units.
+ *
+ * \param weights              the weight matrix to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_projection_weights_from_patterns(double **weights, spike_T **patterns,
+                                         int max_patterns, int max_units,
+                                         int remove_self_coupling);
+
+
+/**
+ * Integer version of hn_hebb_weights_from_patterns(): count matrix
+ * entry (i,j) is the sum of patterns[n][i] * patterns[n][j] and the
+ * scale is set to 1./max_units; the count matrix is expected to be
+ * pre-allocated with dimensions max_units * max_units, and
+ * max_patterns may not exceed COUNT_MAX.
+ *
+ * \param weights              the count weights to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_hebb_counts_from_patterns(hn_count_weights *weights, spike_T **patterns,
+                                  int max_patterns, int max_units,
+                                  int remove_self_coupling);
+
+
+/**
+ * Same as hn_hebb_weights_from_patterns(), computed from the bitsets of
+ * the activations of each unit across the patterns: each weight takes
+ * hn_packed_length(max_patterns) popcounts instead of max_patterns
+ * multiply-adds (see hn_bitset_correlation_update() in hn_kernels.h).
+ * The result is exactly the same.
+ *
+ * \param weights              the weight matrix to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_hebb_weights_from_patterns_bitwise(double **weights,
+                                        spike_T **patterns, int max_patterns,
+                                        int max_units,
+                                        int remove_self_coupling);
+
+
+/**
+ * Same as hn_hebb_counts_from_patterns(), computed from the bitsets of
+ * the activations of each unit across the patterns, as
+ * hn_hebb_weights_from_patterns_bitwise().
+ *
+ * \param weights              the count weights to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns (at most COUNT_MAX)
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_hebb_counts_from_patterns_bitwise(hn_count_weights *weights,
+                                          spike_T **patterns,
+                                          int max_patterns, int max_units,
+                                          int remove_self_coupling);
+
+
+/**
+ * Integer version of hn_hebb_weights_increment_with_pattern()
+ * (no more than COUNT_MAX patterns can be learnt: the program is
+ * killed, rather than let a count wrap around, if one is at COUNT_MAX
+ * in absolute value).
+ *
+ * \param weights              the count weights to be updated
+ * \param pattern              the pattern to be learnt
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_hebb_counts_increment_with_pattern(hn_count_weights *weights,
+                                           spike_T *pattern, size_t max_units,
+                                           int remove_self_coupling);
+
+
+/**
+ * Copy the upper triangle of a symmetric weight matrix
+ * into packed storage.
+ *
+ * \param packed_weights  PackedMatrixLength(max_units) array to be filled
+ * \param weights         the max_units * max_units weight matrix
+ * \param max_units       the size of the network
+ *
+ */
+void hn_pack_weights(double *packed_weights, double **weights,
+                     size_t max_units);
+
+
+/**
+ * Packed version of hn_hebb_weights_from_patterns(): only the upper
+ * triangle is computed, so the work is halved as well as the memory;
+ * the array is expected to be pre-allocated with
+ * PackedMatrixLength(max_units) elements.
+ *
+ * \param weights              the packed weight matrix to be filled
+ * \param patterns             list of spike_T patterns
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ */
+void hn_hebb_packed_weights_from_patterns(double *weights, spike_T **patterns,
+                                          int max_patterns, int max_units,
+                                          int remove_self_coupling);
+
+
+/**
+ * Packed version of hn_hebb_weights_increment_with_pattern().
+ *
+ * \param weights              the packed weight matrix to be updated
+ * \param pattern              the pattern to be learnt
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ *
+ */
+void hn_hebb_packed_weights_increment_with_pattern(double *weights,
+                                                   spike_T *pattern,
+                                                   int max_units,
+                                                   int remove_self_coupling);
+
+
 /* THE TWO FOLLOWING FUNCTIONS ARE STRAIGHTFORWARD VARIANTS OF THE ABOVE,
  * BUT THEY HAVEN'T BEEN TESTED! */
  
@@ -169,4 +589,67 @@ void hn_saturated_weights_increment_with_pattern(double **weights,
                                                  int remove_self_coupling);
 
 
+/**
+ * Integer version of hn_saturated_weights_from_patterns(), for fast
+ * capacity sweeps with saturated synapses (palimpsests): count matrix
+ * entry (i,j) accumulates patterns[n][i] * patterns[n][j], clamped to
+ * [-bound, bound] after each pattern, where bound is the integer part of
+ * saturation * max_units, and the scale is set to 1./max_units. The
+ * weights are the same as the floating-point ones when
+ * saturation * max_units is an integer (and max_units a power of 2, for
+ * the rounding of the latter). The clamps are branch-free and vectorised
+ * (see hn_saturated_count_update() in hn_kernels.h), and the network can
+ * be recalled from the counts directly (hn_network_from_counts()). The
+ * count matrix is expected to be pre-allocated with dimensions
+ * max_units * max_units, and the bound may not exceed COUNT_MAX.
+ *
+ * \param weights              the count weights to be filled
+ * \param patterns             list of spike_T patterns
+ * \param saturation           the positive saturation level
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ */
+void hn_saturated_counts_from_patterns(hn_count_weights *weights,
+                                       spike_T **patterns, double saturation,
+                                       int max_patterns, int max_units,
+                                       int remove_self_coupling);
+
+
+/**
+ * Incremental version of hn_saturated_counts_from_patterns(): add the
+ * autocorrelation of pattern to the counts and saturate them.
+ *
+ * \param weights              the count weights to be updated
+ * \param pattern              the pattern to be learnt
+ * \param saturation           the positive saturation level
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ */
+void hn_saturated_counts_increment_with_pattern(hn_count_weights *weights,
+                                                spike_T *pattern,
+                                                double saturation,
+                                                int max_units,
+                                                int remove_self_coupling);
+
+
+/**
+ * Same as hn_saturated_counts_increment_with_pattern() on each pattern in
+ * turn, with a single sweep of the count matrix.
+ *
+ * \param weights              the count weights to be updated
+ * \param patterns             list of spike_T patterns to be learnt
+ * \param saturation           the positive saturation level
+ * \param max_patterns         the number of patterns
+ * \param max_units            the size of the network
+ * \param remove_self_coupling  1 to suppress diagonal (else 0)
+ */
+void hn_saturated_counts_increment_with_patterns(hn_count_weights *weights,
+                                                 spike_T **patterns,
+                                                 double saturation,
+                                                 int max_patterns,
+                                                 int max_units,
+                                                 int remove_self_coupling);
+
+
 #endif /* HN_NETWORK_H */
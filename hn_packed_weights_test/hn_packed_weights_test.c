@@ -0,0 +1,136 @@
+/*****************************************************
+ * C FILE (main): hn_packed_weights_test.c           *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares learning, I/O and recall with  *
+ *           packed upper-triangular weights to the  *
+ *           ones with the full weight matrix        *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Even size and odd number of patterns: no field is ever 0 */
+#define MAX_UNITS 300
+#define MAX_PATTERNS 21
+#define MAX_TESTS 10
+#define FLIP_PROBABILITY 0.1
+#define W_FILENAME "packed_weights_test.bin"
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t length = PackedMatrixLength(max_units);
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Packed upper-triangular vs. full weights\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixZeros(weights, max_units, max_units);
+    double *packed = malloc(length * sizeof (double));
+    KillUnless(packed != NULL);
+    double *learnt = calloc(length, sizeof (double));
+    KillUnless(learnt != NULL);
+    double *read_back = malloc(length * sizeof (double));
+    KillUnless(read_back != NULL);
+    
+    /* Incremental learning */
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_hebb_weights_increment_with_pattern(weights, patterns[n],
+                                               max_units, 1);
+        hn_hebb_packed_weights_increment_with_pattern(learnt, patterns[n],
+                                                      max_units, 1);
+    }
+    hn_pack_weights(packed, weights, max_units);
+    int same = !memcmp(packed, learnt, length * sizeof (double));
+    printf("Incremental learning: %s\n", same ? "identical" : "DIFFERENT");
+    failures += !same;
+    
+    /* Learning in one go */
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_hebb_packed_weights_from_patterns(learnt, patterns, max_patterns,
+                                         max_units, 1);
+    hn_pack_weights(packed, weights, max_units);
+    same = !memcmp(packed, learnt, length * sizeof (double));
+    printf("Learning from patterns: %s\n", same ? "identical" : "DIFFERENT");
+    failures += !same;
+    
+    /* Save and read back */
+    same = hn_save_packed_weights(packed, W_FILENAME, max_units) == IOSuccess &&
+           hn_read_packed_weights(read_back, W_FILENAME, max_units) == IOSuccess &&
+           !memcmp(packed, read_back, length * sizeof (double));
+    printf("Save and read back: %s\n", same ? "identical" : "DIFFERENT");
+    failures += !same;
+    /* A full matrix file doesn't pass for a packed one */
+    KillUnless(hn_save_weights(weights, W_FILENAME, max_units) == IOSuccess);
+    same = hn_read_packed_weights(read_back, W_FILENAME, max_units) == IOFailure;
+    printf("Full matrix file rejected: %s\n\n", same ? "yes" : "NO");
+    failures += !same;
+    remove(W_FILENAME);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_SEQUENTIAL);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *packed_probe = hn_pattern_copy(probe, max_units);
+        
+        hn_network net = hn_network_from_params(weights, 0., probe);
+        long updates = hn_test_pattern(net, NULL, max_units, max_units, utils);
+        hn_network packed_net = hn_network_from_packed(packed, 0.,
+                                                       packed_probe);
+        long packed_updates = hn_test_pattern(packed_net, NULL, max_units,
+                                              max_units, utils);
+        size_t overlaps = hn_overlap_frequency(probe, packed_probe, max_units);
+        
+        printf("Probe %zu: updates = %ld (packed: %ld); "
+               "final states overlap = %zu/%zu\n",
+               n, updates, packed_updates, overlaps, max_units);
+        failures += overlaps != max_units || updates != packed_updates;
+        
+        free(probe);
+        free(packed_probe);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    free(packed);
+    free(learnt);
+    free(read_back);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,106 @@
+/*****************************************************
+ * C FILE (main): hn_parallel_test.c                 *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks that the multithreaded recall    *
+ *           ends in a stable state and retrieves    *
+ *           the memories                            *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 50
+#define MAX_TESTS 10
+#define MAX_THREADS 4
+#define FLIP_PROBABILITY 0.1
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    
+    srand(1);
+    
+#   ifdef _OPENMP
+    omp_set_num_threads(MAX_THREADS);
+#   endif
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Multithreaded asynchronous recall\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_PARALLEL);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *counts_probe = hn_pattern_copy(probe, max_units);
+        
+        long updates = hn_test_pattern(hn_network_from_params(weights, 0.,
+                                                              probe),
+                                       NULL, max_units, max_units, utils);
+        long counts_updates = hn_test_pattern(hn_network_from_counts(counts, 0.,
+                                                                     counts_probe),
+                                              NULL, max_units, max_units, utils);
+        size_t unstable = unstable_units(weights, probe, max_units);
+        size_t counts_unstable = unstable_units(weights, counts_probe, max_units);
+        size_t retrieved = hn_overlap_frequency(probe, patterns[n], max_units);
+        
+        printf("Probe %zu: updates = %ld (counts: %ld); unstable units = %zu "
+               "(counts: %zu); retrieved %zu/%zu\n", n, updates,
+               counts_updates, unstable, counts_unstable, retrieved, max_units);
+        failures += unstable != 0 || counts_unstable != 0 ||
+                    retrieved != max_units;
+        
+        free(probe);
+        free(counts_probe);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
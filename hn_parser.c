@@ -11,6 +11,9 @@
  *                                                   *
  *****************************************************/
 
+/* strdup() and realpath() are POSIX, not C11 */
+#define _DEFAULT_SOURCE
+
 #include "debug_log.h"
 #include "hn_parser.h"
 #include "hn_types.h"
@@ -42,7 +45,7 @@ char *g_help_string = "\nUsage:\n"
     "-w W_FILENAME        specify the name of the  binary file containing the weights matrix\n(./example_data_files/weights500.bin)\n"
     "-p P_FILENAME        specify the name of the binary file containing the list of patterns\n(./example_data_files/patterns500.bin)\n"
     "-s S_FILENAME        specify the name of the save file for a list of doubles\n(results.bin)\n"
-    "-m MODE_NAME         string representing the update mode: accepts either MODE_SEQUENTIAL or MODE_RANDOM\n(MODE_SEQUENTIAL)\n"
+    "-m MODE_NAME         string representing the update mode: accepts MODE_SEQUENTIAL, MODE_RANDOM,\nMODE_SYNCHRONOUS, MODE_PARALLEL, MODE_WORKLIST, MODE_GREEDY\nor MODE_RANDOM_PERMUTATION (MODE_SEQUENTIAL)\n"
     "-t THRESHOLD         set the threshold of the activation function (0.0)\n"
     "-h, --help           this brief usage explanation\n"
     "-v, --version        displays version;\n";
@@ -87,6 +90,8 @@ hn_options *hn_retrieve_options(hn_options *opts, int argc, char **argv)
             Logger("current optarg = \"%s\"\n", optarg);
             set_option_argument(opts, code, optarg);
         }
+        
+        code = getopt_long(argc, argv, OptionCodes, g_longopts, NULL);
     }
 
     /* Check paths */
@@ -183,9 +188,19 @@ void set_option_argument(hn_options *opts, char code, char *token)
     case 'm':
         if (strcmp(token, "MODE_SEQUENTIAL") == 0) {
             opts->mode = MODE_SEQUENTIAL;
+        } else if (strcmp(token, "MODE_SYNCHRONOUS") == 0) {
+            opts->mode = MODE_SYNCHRONOUS;
+        } else if (strcmp(token, "MODE_PARALLEL") == 0) {
+            opts->mode = MODE_PARALLEL;
+        } else if (strcmp(token, "MODE_WORKLIST") == 0) {
+            opts->mode = MODE_WORKLIST;
+        } else if (strcmp(token, "MODE_GREEDY") == 0) {
+            opts->mode = MODE_GREEDY;
+        } else if (strcmp(token, "MODE_RANDOM_PERMUTATION") == 0) {
+            opts->mode = MODE_RANDOM_PERMUTATION;
         } else {
             opts->mode = MODE_RANDOM;
-            if (strcmp(token, "MODE_RANDOM") == 0) {
+            if (strcmp(token, "MODE_RANDOM") != 0) {
                 PrintWarning("Unknown update mode \"%s\". "
                              "Defaulting to MODE_RANDOM\n", token);
             }
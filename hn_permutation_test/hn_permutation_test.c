@@ -0,0 +1,178 @@
+/*****************************************************
+ * C FILE (main): hn_permutation_test.c              *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks the generator, the shuffled      *
+ *           sweeps of MODE_RANDOM_PERMUTATION and   *
+ *           the recall that uses them               *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_rng.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 50
+#define MAX_TESTS 10
+#define MAX_SWEEPS 3
+#define MAX_DRAWS 300000
+#define DRAW_BOUND 3
+#define FLIP_PROBABILITY 0.1
+
+
+/* Every sweep must visit each unit once, in a different order */
+static size_t check_sweeps(size_t max_units)
+{
+    size_t failures = 0;
+    hn_dynamics dynamics;
+    dynamics.permutation = malloc(max_units * sizeof (size_t));
+    size_t *previous = malloc(max_units * sizeof (size_t));
+    int *visits = malloc(max_units * sizeof (int));
+    KillUnless(dynamics.permutation != NULL && previous != NULL &&
+               visits != NULL);
+    for (size_t i = 0; i < max_units; ++i) {
+        dynamics.permutation[i] = i;
+        previous[i] = i;
+    }
+    
+    hn_rng_seed(&dynamics.rng, 1);
+    permutation_select_unit(&dynamics, max_units, 1);
+    for (size_t s = 0; s < MAX_SWEEPS; ++s) {
+        memset(visits, 0, max_units * sizeof (int));
+        size_t unmoved = 0;
+        for (size_t i = 0; i < max_units; ++i) {
+            size_t unit = permutation_select_unit(&dynamics, max_units, 0);
+            ++visits[unit];
+            unmoved += unit == previous[i];
+            previous[i] = unit;
+        }
+        size_t missed = 0;
+        for (size_t i = 0; i < max_units; ++i) {
+            missed += visits[i] != 1;
+        }
+        printf("Sweep %zu: units not visited once = %zu; "
+               "same position as before = %zu\n", s, missed, unmoved);
+        failures += missed != 0 || unmoved == max_units;
+    }
+    
+    free(visits);
+    free(previous);
+    free(dynamics.permutation);
+    return failures;
+}
+
+
+/* The bounded draws must be in range and (roughly) equally likely */
+static size_t check_draws(void)
+{
+    size_t failures = 0;
+    size_t counts[DRAW_BOUND] = {0};
+    hn_rng rng;
+    hn_rng_seed(&rng, 1);
+    
+    for (size_t n = 0; n < MAX_DRAWS; ++n) {
+        uint64_t x = hn_rng_bounded(&rng, DRAW_BOUND);
+        KillUnless(x < DRAW_BOUND);
+        ++counts[x];
+    }
+    for (size_t k = 0; k < DRAW_BOUND; ++k) {
+        double frequency = (double)counts[k] / MAX_DRAWS;
+        printf("Frequency of %zu: %f\n", k, frequency);
+        failures += frequency < 0.99 / DRAW_BOUND ||
+                    frequency > 1.01 / DRAW_BOUND;
+    }
+    
+    /* Huge bounds reject almost half of the outputs, but stay in range */
+    uint64_t bound = (UINT64_MAX >> 1) + 2;
+    for (size_t n = 0; n < MAX_DRAWS; ++n) {
+        failures += hn_rng_bounded(&rng, bound) >= bound;
+    }
+    return failures;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Sweeps in shuffled order (MODE_RANDOM_PERMUTATION)\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    failures += check_draws();
+    failures += check_sweeps(max_units);
+    printf("\n");
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_RANDOM_PERMUTATION);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *replay = hn_pattern_copy(probe, max_units);
+        
+        /* The same seed for rand() must give the same recall */
+        srand(n);
+        long updates = hn_test_pattern(hn_network_from_params(weights, 0.,
+                                                              probe),
+                                       NULL, max_units, max_units, utils);
+        srand(n);
+        long replay_updates = hn_test_pattern(hn_network_from_params(weights,
+                                                                     0.,
+                                                                     replay),
+                                              NULL, max_units, max_units,
+                                              utils);
+        size_t unstable = unstable_units(weights, probe, max_units);
+        size_t retrieved = hn_overlap_frequency(probe, patterns[n], max_units);
+        int replayed = replay_updates == updates &&
+                       hn_overlap_frequency(probe, replay, max_units) ==
+                       max_units;
+        
+        printf("Probe %zu: updates = %ld; unstable units = %zu; "
+               "retrieved %zu/%zu; %s\n", n, updates, unstable, retrieved,
+               max_units, replayed ? "reproducible" : "NOT REPRODUCIBLE");
+        failures += unstable != 0 || retrieved != max_units || !replayed;
+        
+        free(probe);
+        free(replay);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,228 @@
+/*****************************************************
+ * C FILE (main): hn_projection_test.c               *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the incremental projection     *
+ *           (pseudo-inverse) weights with the ones  *
+ *           from the inverse correlation matrix,    *
+ *           checks that the patterns are stored,    *
+ *           and times them                          *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_kernels.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TIMED_UNITS 2000
+#define TIMED_PATTERNS 100
+
+
+/* The rule as stated: weights = X C^-1 X^T with C = X^T X, whose inverse
+ * is computed by Gauss-Jordan elimination (partial pivoting) */
+static void direct_projection_weights(double **weights, spike_T **patterns,
+                                      size_t max_patterns, size_t max_units,
+                                      int remove_self_coupling)
+{
+    double **correlations, **inverse;
+    MatrixAlloc(correlations, Max(max_patterns, 1), Max(max_patterns, 1));
+    MatrixAlloc(inverse, Max(max_patterns, 1), Max(max_patterns, 1));
+    for (size_t m = 0; m < max_patterns; ++m) {
+        for (size_t n = 0; n < max_patterns; ++n) {
+            double correlation = 0.;
+            for (size_t i = 0; i < max_units; ++i) {
+                correlation += patterns[m][i] * patterns[n][i];
+            }
+            correlations[m][n] = correlation;
+            inverse[m][n] = m == n;
+        }
+    }
+    for (size_t k = 0; k < max_patterns; ++k) {
+        size_t pivot = k;
+        for (size_t m = k + 1; m < max_patterns; ++m) {
+            if (fabs(correlations[m][k]) > fabs(correlations[pivot][k])) {
+                pivot = m;
+            }
+        }
+        for (size_t n = 0; n < max_patterns; ++n) {
+            double swap = correlations[k][n];
+            correlations[k][n] = correlations[pivot][n];
+            correlations[pivot][n] = swap;
+            swap = inverse[k][n];
+            inverse[k][n] = inverse[pivot][n];
+            inverse[pivot][n] = swap;
+        }
+
+        double diagonal = correlations[k][k];
+        for (size_t n = 0; n < max_patterns; ++n) {
+            correlations[k][n] /= diagonal;
+            inverse[k][n] /= diagonal;
+        }
+        for (size_t m = 0; m < max_patterns; ++m) {
+            double factor = correlations[m][k];
+            if (m == k || factor == 0.) {
+                continue;
+            }
+            for (size_t n = 0; n < max_patterns; ++n) {
+                correlations[m][n] -= factor * correlations[k][n];
+                inverse[m][n] -= factor * inverse[k][n];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            double weight = 0.;
+            for (size_t m = 0; m < max_patterns; ++m) {
+                for (size_t n = 0; n < max_patterns; ++n) {
+                    weight += patterns[m][i] * inverse[m][n] * patterns[n][j];
+                }
+            }
+            weights[i][j] = weight;
+        }
+        if (remove_self_coupling) {
+            weights[i][i] = 0.;
+        }
+    }
+    MatrixFree(inverse);
+    MatrixFree(correlations);
+}
+
+
+/* Learn random patterns incrementally and from the inverse correlation
+ * matrix: the results must agree up to rounding, be exactly symmetric
+ * and store all the patterns; learning a pattern again, or its opposite,
+ * must leave the weights as they are */
+static size_t check_size(size_t max_units, size_t max_patterns)
+{
+    size_t failures = 0;
+    spike_T **patterns;
+    MatrixAlloc(patterns, Max(max_patterns, 1), max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    double **expected, **weights, **repeated;
+    MatrixAlloc(expected, max_units, max_units);
+    MatrixAlloc(weights, max_units, max_units);
+    MatrixAlloc(repeated, max_units, max_units);
+    double *projector_diagonal = malloc(max_units * sizeof (double));
+    KillUnless(projector_diagonal != NULL);
+    spike_T *opposite = malloc(max_units * sizeof (spike_T));
+    KillUnless(opposite != NULL);
+
+    for (int self = 0; self <= 1; ++self) {
+        direct_projection_weights(expected, patterns, max_patterns, max_units,
+                                  self);
+        hn_projection_weights_from_patterns(weights, patterns, max_patterns,
+                                            max_units, self);
+        double from_scratch = max_difference(weights, expected, max_units);
+        size_t asymmetries = count_asymmetries(weights, max_units);
+        size_t fixed_points = count_fixed_points(weights, patterns,
+                                                 max_patterns, max_units);
+
+        /* One by one, then all the patterns again and their opposites */
+        for (size_t i = 0; i < max_units; ++i) {
+            memset(repeated[i], 0, max_units * sizeof (double));
+            projector_diagonal[i] = 0.;
+        }
+        for (size_t n = 0; n < max_patterns; ++n) {
+            hn_projection_weights_increment_with_pattern(repeated,
+                                                         projector_diagonal,
+                                                         patterns[n],
+                                                         max_units, self);
+        }
+        for (size_t n = 0; n < max_patterns; ++n) {
+            for (size_t i = 0; i < max_units; ++i) {
+                opposite[i] = -patterns[n][i];
+            }
+            hn_projection_weights_increment_with_pattern(repeated,
+                                                         projector_diagonal,
+                                                         patterns[n],
+                                                         max_units, self);
+            hn_projection_weights_increment_with_pattern(repeated,
+                                                         projector_diagonal,
+                                                         opposite,
+                                                         max_units, self);
+        }
+        double relearnt = max_difference(repeated, weights, max_units);
+
+        printf("N = %4zu, P = %3zu, %s self-coupling: difference %g "
+               "(from scratch), %g (relearnt); %zu asymmetric entries, "
+               "%zu fixed points\n", max_units, max_patterns,
+               self ? "without" : "with", from_scratch, relearnt,
+               asymmetries, fixed_points);
+        failures += from_scratch > 1e-10 || relearnt > 1e-10 ||
+                    asymmetries != 0 || fixed_points != max_patterns;
+    }
+
+    free(opposite);
+    free(projector_diagonal);
+    MatrixFree(repeated);
+    MatrixFree(weights);
+    MatrixFree(expected);
+    MatrixFree(patterns);
+    return failures;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t failures = 0;
+
+    srand(1);
+
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Projection learning rule (%s kernels)\n\n", hn_kernels_isa());
+
+    /* Tiny sizes, and well beyond the capacity of the Hebb rule */
+    failures += check_size(2, 1);
+    failures += check_size(5, 0);
+    failures += check_size(37, 11);
+    failures += check_size(64, 32);
+    failures += check_size(101, 60);
+
+    spike_T **patterns;
+    MatrixAlloc(patterns, TIMED_PATTERNS, TIMED_UNITS);
+    for (size_t n = 0; n < TIMED_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, TIMED_UNITS);
+    }
+    double **weights;
+    MatrixAlloc(weights, TIMED_UNITS, TIMED_UNITS);
+
+    clock_t clock_start = clock();
+    hn_projection_weights_from_patterns(weights, patterns, TIMED_PATTERNS,
+                                        TIMED_UNITS, 1);
+    clock_t clock_end = clock();
+    size_t fixed_points = count_fixed_points(weights, patterns,
+                                             TIMED_PATTERNS, TIMED_UNITS);
+
+    printf("\nN = %d, P = %d (CPU time of all threads): %.3f s, "
+           "%zu fixed points\n", TIMED_UNITS, TIMED_PATTERNS,
+           (double)(clock_end - clock_start) / CLOCKS_PER_SEC, fixed_points);
+    failures += fixed_points != TIMED_PATTERNS;
+
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+
+    MatrixFree(weights);
+    MatrixFree(patterns);
+
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
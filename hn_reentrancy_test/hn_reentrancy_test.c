@@ -0,0 +1,154 @@
+/*****************************************************
+ * C FILE (main): hn_reentrancy_test.c               *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks that recalls running on several  *
+ *           threads at once give the same results   *
+ *           as when they run one after the other    *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_kernels.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#define MAX_UNITS 500
+#define MAX_PATTERNS 25
+#define MAX_PROBES 16
+#define MAX_THREADS 4
+#define FLIP_PROBABILITY 0.15
+
+
+/* Run the recall of every probe on its own copy, concurrently and then
+ * one after the other (the deterministic modes must agree exactly); the
+ * first concurrent recalls also select the kernels, all at once */
+static size_t compare_recalls(double **weights, spike_T **probes,
+                              size_t max_probes, size_t max_units,
+                              enum hn_mode mode)
+{
+    size_t mismatches = 0;
+    hn_mode_utils utils = hn_utils_with_mode(mode);
+    
+    spike_T **serial, **concurrent;
+    MatrixAlloc(serial, max_probes, max_units);
+    MatrixAlloc(concurrent, max_probes, max_units);
+    long serial_updates[MAX_PROBES], concurrent_updates[MAX_PROBES];
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        memcpy(serial[k], probes[k], max_units * sizeof (spike_T));
+        memcpy(concurrent[k], probes[k], max_units * sizeof (spike_T));
+    }
+    
+#   pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < max_probes; ++k) {
+        hn_network net = hn_network_from_params(weights, 0., concurrent[k]);
+        concurrent_updates[k] = hn_test_pattern(net, NULL, max_units,
+                                                max_units, utils);
+    }
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        serial_updates[k] = hn_test_pattern(hn_network_from_params(weights,
+                                                                   0.,
+                                                                   serial[k]),
+                                            NULL, max_units, max_units, utils);
+    }
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        mismatches += serial_updates[k] != concurrent_updates[k] ||
+                      hn_overlap_frequency(serial[k], concurrent[k],
+                                           max_units) != max_units;
+    }
+    
+    MatrixFree(concurrent);
+    MatrixFree(serial);
+    return mismatches;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t max_probes = MAX_PROBES;
+    size_t failures = 0;
+    const enum hn_mode modes[] = {MODE_SEQUENTIAL, MODE_GREEDY};
+    const char *mode_names[] = {"MODE_SEQUENTIAL", "MODE_GREEDY"};
+    
+    srand(1);
+    
+#   ifdef _OPENMP
+    omp_set_num_threads(MAX_THREADS);
+#   endif
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Concurrent vs. one-after-the-other recalls\n"
+           "Number of units = %d, number of patterns = %d, "
+           "number of probes = %d\n\n", MAX_UNITS, MAX_PATTERNS, MAX_PROBES);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    /* Corrupted copies of the stored patterns */
+    spike_T **probes;
+    MatrixAlloc(probes, max_probes, max_units);
+    for (size_t k = 0; k < max_probes; ++k) {
+        for (size_t i = 0; i < max_units; ++i) {
+            probes[k][i] = patterns[k % max_patterns][i];
+            if ((double)rand() / RAND_MAX < FLIP_PROBABILITY) {
+                probes[k][i] = -probes[k][i];
+            }
+        }
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    /* (One pattern at a time: these loops use no kernels, so they are
+     * still unselected when the recalls start) */
+    for (size_t i = 0; i < max_units; ++i) {
+        memset(weights[i], 0, max_units * sizeof (double));
+    }
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_hebb_weights_increment_with_pattern(weights, patterns[n],
+                                               max_units, 1);
+    }
+    
+    for (size_t m = 0; m < 2; ++m) {
+        size_t mismatches = compare_recalls(weights, probes, max_probes,
+                                            max_units, modes[m]);
+        printf("%-16s: %s\n", mode_names[m],
+               mismatches == 0 ? "identical" : "DIFFERENT");
+        failures += mismatches;
+    }
+    
+    printf("\n(%s kernels)\n", hn_kernels_isa());
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(weights);
+    MatrixFree(probes);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
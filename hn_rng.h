@@ -0,0 +1,156 @@
+/*****************************************************
+ * HEADER FILE: hn_rng.h                             *
+ * MODULE: Pseudo-random number generator            *
+ *                                                   *
+ * FUNCTION: xoshiro256** generator, unbiased        *
+ *           bounded draws and shuffles (the state   *
+ *           is held by the caller, unlike rand())   *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_RNG_H
+#define HN_RNG_H
+
+#include "hn_types.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/*
+ * The generator is xoshiro256** by D. Blackman and S. Vigna
+ * (http://prng.di.unimi.it/), seeded through SplitMix64 as they advise.
+ * All functions are small enough to be inlined in the update loops.
+ */
+
+
+static inline uint64_t hn_rng_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+
+/**
+ * Initialise the state of a generator from a single 64-bit seed.
+ *
+ * \param rng    the generator
+ * \param seed   any value (equal seeds give equal sequences)
+ */
+static inline void hn_rng_seed(hn_rng *rng, uint64_t seed)
+{
+    for (int k = 0; k < 4; ++k) {
+        /* SplitMix64: never yields the all-zero state */
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->state[k] = z ^ (z >> 31);
+    }
+}
+
+
+/**
+ * Seed a generator from rand(), so that srand() still makes a whole
+ * simulation reproducible (rand() is called 4 times).
+ *
+ * \param rng    the generator
+ */
+static inline void hn_rng_seed_from_rand(hn_rng *rng)
+{
+    uint64_t seed = 0;
+    for (int k = 0; k < 4; ++k) {
+        seed = (seed << 16) ^ (uint64_t)rand();
+    }
+    hn_rng_seed(rng, seed);
+}
+
+
+/**
+ * Next 64-bit output of the generator.
+ *
+ * \param rng    the generator
+ *
+ * \return       a uniformly distributed 64-bit integer
+ */
+static inline uint64_t hn_rng_next(hn_rng *rng)
+{
+    uint64_t *s = rng->state;
+    uint64_t result = hn_rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = hn_rng_rotl(s[3], 45);
+
+    return result;
+}
+
+
+/**
+ * Fill an array with uniformly distributed doubles in [0, 1), from the
+ * top 53 bits of successive outputs.
+ *
+ * \param rng      the generator
+ * \param uniforms the array to be filled
+ * \param length   the length of the array
+ */
+static inline void hn_rng_fill_uniform(hn_rng *rng, double *uniforms,
+                                       size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        uniforms[i] = (hn_rng_next(rng) >> 11) * 0x1.0p-53;
+    }
+}
+
+
+/**
+ * Draw an integer 0 <= n <= bound-1 with exactly uniform distribution
+ * (outputs in the incomplete last block of bound values are rejected).
+ *
+ * \param rng    the generator
+ * \param bound  the number of possible values (positive)
+ *
+ * \return       the random integer
+ */
+static inline uint64_t hn_rng_bounded(hn_rng *rng, uint64_t bound)
+{
+    /* 2^64 mod bound, computed in 64 bits */
+    uint64_t rejected = -bound % bound;
+    uint64_t x;
+    do {
+        x = hn_rng_next(rng);
+    } while (x < rejected);
+    return x % bound;
+}
+
+
+/**
+ * Shuffle an array of indices in place (Fisher-Yates): all the
+ * permutations are equally likely.
+ *
+ * \param rng     the generator
+ * \param array   the indices to shuffle
+ * \param length  the length of the array
+ */
+static inline void hn_rng_shuffle(hn_rng *rng, size_t *array, size_t length)
+{
+    for (size_t i = length; i > 1; --i) {
+        size_t j = hn_rng_bounded(rng, i);
+        size_t tmp = array[i - 1];
+        array[i - 1] = array[j];
+        array[j] = tmp;
+    }
+}
+
+
+#endif /* HN_RNG_H */
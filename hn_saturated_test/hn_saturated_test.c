@@ -0,0 +1,237 @@
+/*****************************************************
+ * C FILE (main): hn_saturated_test.c                *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the saturated integer counts   *
+ *           with the clamped sums pattern after     *
+ *           pattern and with the floating-point     *
+ *           saturated weights, recalls from both,   *
+ *           and times them                          *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_kernels.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RECALL_UNITS 256
+#define RECALL_PATTERNS 40
+#define RECALL_BOUND 4
+#define RECALL_PROBES 20
+#define TIMED_UNITS 2000
+#define TIMED_PATTERNS 200
+
+
+/* The rule as stated: each count is clamped after each pattern */
+static void naive_saturated_counts(count_T **counts, spike_T **patterns,
+                                   size_t max_patterns, size_t max_units,
+                                   int bound, int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            int count = 0;
+            for (size_t n = 0; n < max_patterns; ++n) {
+                count += patterns[n][i] * patterns[n][j];
+                count = Min(count, bound);
+                count = Max(count, -bound);
+            }
+            counts[i][j] = (count_T)count;
+        }
+        if (remove_self_coupling) {
+            counts[i][i] = 0;
+        }
+    }
+}
+
+
+/* Learn random patterns with the naive clamps and with the kernels (from
+ * scratch, one by one, and half of them at once): the counts must be
+ * exactly the same */
+static size_t check_size(size_t max_units, size_t max_patterns, int bound)
+{
+    size_t failures = 0;
+    spike_T **patterns;
+    MatrixAlloc(patterns, Max(max_patterns, 1), max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    hn_count_weights expected, counts;
+    MatrixAlloc(expected.counts, max_units, max_units);
+    MatrixAlloc(counts.counts, max_units, max_units);
+    double saturation = (double)bound / max_units;
+
+    for (int self = 0; self <= 1; ++self) {
+        naive_saturated_counts(expected.counts, patterns, max_patterns,
+                               max_units, bound, self);
+        hn_saturated_counts_from_patterns(&counts, patterns, saturation,
+                                          max_patterns, max_units, self);
+        size_t from_scratch = count_mismatches(counts.counts, expected.counts,
+                                               max_units) +
+                              (counts.scale != 1. / max_units);
+
+        size_t first = max_patterns / 2;
+        for (size_t i = 0; i < max_units; ++i) {
+            memset(counts.counts[i], 0, max_units * sizeof (count_T));
+        }
+        for (size_t n = 0; n < first; ++n) {
+            hn_saturated_counts_increment_with_pattern(&counts, patterns[n],
+                                                       saturation, max_units,
+                                                       self);
+        }
+        hn_saturated_counts_increment_with_patterns(&counts, patterns + first,
+                                                    saturation,
+                                                    max_patterns - first,
+                                                    max_units, self);
+        size_t incremental = count_mismatches(counts.counts, expected.counts,
+                                              max_units);
+
+        printf("N = %4zu, P = %3zu, bound %2d, %s self-coupling: %zu counts "
+               "differ (from scratch), %zu (incremental)\n", max_units,
+               max_patterns, bound, self ? "without" : "with", from_scratch,
+               incremental);
+        failures += from_scratch != 0 || incremental != 0;
+    }
+
+    MatrixFree(counts.counts);
+    MatrixFree(expected.counts);
+    MatrixFree(patterns);
+    return failures;
+}
+
+
+/* With max_units a power of 2 and an integer bound, the floating-point
+ * saturated weights are exact: they must be the scaled counts, and the
+ * recalls from noisy probes must reach the same states */
+static size_t check_recall(void)
+{
+    size_t failures = 0;
+    spike_T **patterns;
+    MatrixAlloc(patterns, RECALL_PATTERNS, RECALL_UNITS);
+    for (size_t n = 0; n < RECALL_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, RECALL_UNITS);
+    }
+    double **weights;
+    MatrixAlloc(weights, RECALL_UNITS, RECALL_UNITS);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, RECALL_UNITS, RECALL_UNITS);
+    double saturation = (double)RECALL_BOUND / RECALL_UNITS;
+
+    hn_saturated_weights_from_patterns(weights, patterns, saturation,
+                                       RECALL_PATTERNS, RECALL_UNITS, 1);
+    hn_saturated_counts_from_patterns(&counts, patterns, saturation,
+                                      RECALL_PATTERNS, RECALL_UNITS, 1);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < RECALL_UNITS; ++i) {
+        for (size_t j = 0; j < RECALL_UNITS; ++j) {
+            mismatches += weights[i][j] != counts.counts[i][j] * counts.scale;
+        }
+    }
+
+    spike_T *probe = malloc(RECALL_UNITS * sizeof (spike_T));
+    spike_T *count_probe = malloc(RECALL_UNITS * sizeof (spike_T));
+    KillUnless(probe != NULL && count_probe != NULL);
+    hn_network net = hn_network_from_params(weights, 0., NULL);
+    hn_network count_net = hn_network_from_counts(counts, 0., NULL);
+    hn_mode_utils utils = hn_utils_with_mode(MODE_SEQUENTIAL);
+    size_t different_recalls = 0, recalled = 0;
+    for (size_t k = 0; k < RECALL_PROBES; ++k) {
+        /* A pattern with a tenth of the units flipped */
+        spike_T *pattern = patterns[RECALL_PATTERNS - 1 - k];
+        for (size_t i = 0; i < RECALL_UNITS; ++i) {
+            probe[i] = RandI(10) == 0 ? -pattern[i] : pattern[i];
+        }
+        memcpy(count_probe, probe, RECALL_UNITS * sizeof (spike_T));
+        hn_test_pattern(net, probe, RECALL_UNITS, RECALL_UNITS, utils);
+        hn_test_pattern(count_net, count_probe, RECALL_UNITS, RECALL_UNITS,
+                        utils);
+        different_recalls += memcmp(probe, count_probe,
+                                    RECALL_UNITS * sizeof (spike_T)) != 0;
+        recalled += hn_overlap_frequency(count_probe, pattern,
+                                         RECALL_UNITS) == RECALL_UNITS;
+    }
+
+    printf("\nN = %d, P = %d, bound %d: %zu weights differ from the scaled "
+           "counts, %zu of %d recalls differ (%zu recent patterns "
+           "recalled)\n", RECALL_UNITS, RECALL_PATTERNS, RECALL_BOUND,
+           mismatches, different_recalls, RECALL_PROBES, recalled);
+    failures += mismatches != 0 || different_recalls != 0;
+
+    free(count_probe);
+    free(probe);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    return failures;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t failures = 0;
+
+    srand(1);
+
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Saturated integer synapses (%s kernels)\n\n", hn_kernels_isa());
+
+    /* Sizes that are not multiples of the vectors or tiles, tiny ones,
+     * and bounds from the tightest to one that is never reached */
+    failures += check_size(1, 3, 1);
+    failures += check_size(5, 0, 2);
+    failures += check_size(37, 40, 1);
+    failures += check_size(300, 120, 3);
+    failures += check_size(1030, 60, 7);
+    failures += check_size(64, 50, 100);
+    failures += check_recall();
+
+    spike_T **patterns;
+    MatrixAlloc(patterns, TIMED_PATTERNS, TIMED_UNITS);
+    for (size_t n = 0; n < TIMED_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, TIMED_UNITS);
+    }
+    double **weights;
+    MatrixAlloc(weights, TIMED_UNITS, TIMED_UNITS);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, TIMED_UNITS, TIMED_UNITS);
+    double saturation = 5. / TIMED_UNITS;
+
+    clock_t clock_start = clock();
+    hn_saturated_weights_from_patterns(weights, patterns, saturation,
+                                       TIMED_PATTERNS, TIMED_UNITS, 1);
+    clock_t clock_middle = clock();
+    hn_saturated_counts_from_patterns(&counts, patterns, saturation,
+                                      TIMED_PATTERNS, TIMED_UNITS, 1);
+    clock_t clock_end = clock();
+
+    printf("\nN = %d, P = %d (CPU time of all threads): %.3f s (floating "
+           "point), %.3f s (counts)\n", TIMED_UNITS, TIMED_PATTERNS,
+           (double)(clock_middle - clock_start) / CLOCKS_PER_SEC,
+           (double)(clock_end - clock_middle) / CLOCKS_PER_SEC);
+
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,269 @@
+/*****************************************************
+ * C FILE: hn_small.c                                *
+ * MODULE: Small networks                            *
+ *                                                   *
+ * FUNCTION: Asynchronous recall specialised at      *
+ *           compile time for networks of 8, 16, 32  *
+ *           and 64 units (state held in a bitmask)  *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "debug_log.h"
+#include "hn_macro_utils.h"
+#include "hn_modes.h"
+#include "hn_rng.h"
+#include "hn_small.h"
+#include "hn_types.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The largest size with a specialisation (one bit per unit) */
+#define SMALL_MAX_UNITS 64
+
+
+/* The generic body is inlined into each specialisation, where the size
+ * is a constant: the loops over the units are then unrolled completely */
+#if defined(__GNUC__) || defined(__clang__)
+#  define HN_SMALL_UNROLL   _Pragma("GCC unroll 64")
+#else
+#  define HN_SMALL_UNROLL   /* JUST BLANK */
+#endif
+
+
+/**
+ * Expand the weights of any format into a dense row-major matrix, in
+ * the same units as the fields of hn_test_pattern (counts unscaled).
+ *
+ * @param weights:      the max_units * max_units matrix to be filled
+ * @param network:      the Hopfield Network data structure
+ * @param max_units:    the size of the network
+ */
+static void hn_small_load_weights(double *weights, hn_network net,
+                                  size_t max_units)
+{
+    switch (net.format) {
+    case WEIGHTS_COUNTS:
+        for (size_t i = 0; i < max_units; ++i) {
+            for (size_t j = 0; j < max_units; ++j) {
+                weights[i * max_units + j] = net.counts.counts[i][j];
+            }
+        }
+        break;
+    case WEIGHTS_PACKED:
+        for (size_t i = 0; i < max_units; ++i) {
+            for (size_t j = i; j < max_units; ++j) {
+                double weight = net.packed_weights[PackedRowOffset(i, max_units)
+                                                   + j - i];
+                weights[i * max_units + j] = weight;
+                weights[j * max_units + i] = weight;
+            }
+        }
+        break;
+    case WEIGHTS_SPARSE:
+        memset(weights, 0, max_units * max_units * sizeof (double));
+        for (size_t i = 0; i < max_units; ++i) {
+            for (size_t k = net.sparse.row_starts[i];
+                 k < net.sparse.row_starts[i + 1]; ++k) {
+                weights[i * max_units + net.sparse.columns[k]] =
+                    net.sparse.values[k];
+            }
+        }
+        break;
+    case WEIGHTS_DENSE:
+    default:
+        for (size_t i = 0; i < max_units; ++i) {
+            memcpy(weights + i * max_units, net.weights[i],
+                   max_units * sizeof (double));
+        }
+        break;
+    }
+}
+
+
+/**
+ * The bitmask of the activations that the units would take if updated:
+ * the network is stable iff it equals the current state.
+ *
+ * @param local_fields: the fields of the units
+ * @param threshold:    the threshold, in the same units as the fields
+ * @param max_units:    the size of the network
+ *
+ * @return:             bit i is set iff Sign(field_i - threshold) = +1
+ */
+static ALWAYS_INLINE uint64_t hn_small_targets(const double *local_fields,
+                                               double threshold,
+                                               size_t max_units)
+{
+    uint64_t targets = 0;
+    HN_SMALL_UNROLL
+    for (size_t i = 0; i < max_units; ++i) {
+        targets |= (uint64_t)(local_fields[i] - threshold >= 0) << i;
+    }
+    return targets;
+}
+
+
+/**
+ * Body of every specialisation (see hn_small_recall()): the loops below
+ * have constant bounds once max_units is. The selection and the warnings
+ * reproduce the utilities of hn_modes.c without calling them.
+ *
+ * @param network:              the Hopfield Network data structure
+ * @param max_units:            the size of the network (at most 64)
+ * @param weights:              room for max_units * max_units weights
+ * @param warning_threshold:    consecutive stable updates before a check
+ * @param mode:                 the selection mode
+ * @param rng:                  the generator of the random selections
+ *
+ * @return:                     the number of unit updates until convergence
+ */
+static ALWAYS_INLINE long hn_small_recall_body(hn_network net,
+                                               size_t max_units,
+                                               double *weights,
+                                               size_t warning_threshold,
+                                               enum hn_mode mode, hn_rng *rng)
+{
+    double local_fields[SMALL_MAX_UNITS];
+    size_t permutation[SMALL_MAX_UNITS];
+
+    hn_small_load_weights(weights, net, max_units);
+    double threshold = net.format == WEIGHTS_COUNTS ?
+                       net.threshold / net.counts.scale : net.threshold;
+
+    /* Bit i is set iff unit i is active (+1) */
+    uint64_t state = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        state |= (uint64_t)(net.activations[i] == +1) << i;
+    }
+    for (size_t i = 0; i < max_units; ++i) {
+        const double *row = weights + i * max_units;
+        double local_field = 0.;
+        HN_SMALL_UNROLL
+        for (size_t j = 0; j < max_units; ++j) {
+            local_field += (state >> j & 1) ? row[j] : -row[j];
+        }
+        local_fields[i] = local_field;
+    }
+
+    /* Resetting the selector (see hn_modes.c) */
+    size_t position = 0;
+    if (mode == MODE_RANDOM_PERMUTATION) {
+        for (size_t i = 0; i < max_units; ++i) {
+            permutation[i] = i;
+        }
+        position = max_units;
+    }
+    size_t stability_counter = 0;
+    long update_counter = 0;
+
+    while (hn_small_targets(local_fields, threshold, max_units) != state) {
+        for (;;) {
+            size_t unit;
+            if (mode == MODE_RANDOM) {
+                unit = hn_rng_bounded(rng, max_units);
+            } else if (mode == MODE_RANDOM_PERMUTATION) {
+                if (position >= max_units) {
+                    hn_rng_shuffle(rng, permutation, max_units);
+                    position = 0;
+                }
+                unit = permutation[position++];
+            } else {
+                unit = position++;
+                if (position == max_units) {
+                    position = 0;
+                }
+            }
+            ++update_counter;
+
+            uint64_t target = local_fields[unit] - threshold >= 0;
+            if (target != (state >> unit & 1)) {
+                /* The unit went from -delta/2 to delta/2 */
+                state ^= (uint64_t)1 << unit;
+                double delta = target ? 2. : -2.;
+                const double *row = weights + unit * max_units;
+                HN_SMALL_UNROLL
+                for (size_t i = 0; i < max_units; ++i) {
+                    local_fields[i] += delta * row[i];
+                }
+                stability_counter = 0;
+            } else {
+                ++stability_counter;
+            }
+            if (stability_counter >= warning_threshold) {
+                stability_counter = 0;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < max_units; ++i) {
+        net.activations[i] = (state >> i & 1) ? +1 : -1;
+    }
+    return update_counter;
+}
+
+
+/* Definition of the recall for networks of N units (the weights are
+ * on the stack: 32KB for N = 64) */
+#define HN_SMALL_SPECIALISATION(N)                                          \
+static long hn_small_recall_##N(hn_network net, size_t warning_threshold,   \
+                                enum hn_mode mode, hn_rng *rng)             \
+{                                                                           \
+    double weights[(N) * (N)];                                              \
+    return hn_small_recall_body(net, (N), weights, warning_threshold,       \
+                                mode, rng);                                 \
+}
+
+HN_SMALL_SPECIALISATION(8)
+HN_SMALL_SPECIALISATION(16)
+HN_SMALL_SPECIALISATION(32)
+HN_SMALL_SPECIALISATION(64)
+
+
+int hn_small_recall_available(hn_network net, size_t max_units,
+                              hn_mode_utils utils)
+{
+    if (max_units != 8 && max_units != 16 && max_units != 32 &&
+        max_units != 64) {
+        return 0;
+    }
+    if (utils.schedule != NULL || (utils.mode != MODE_SEQUENTIAL &&
+                                   utils.mode != MODE_RANDOM &&
+                                   utils.mode != MODE_RANDOM_PERMUTATION)) {
+        return 0;
+    }
+    /* Utilities other than the standard ones may do anything */
+    return hn_utils_are_standard(utils);
+}
+
+
+long hn_small_recall(hn_network net, size_t max_units,
+                     size_t warning_threshold, hn_mode_utils utils,
+                     hn_rng *rng)
+{
+    KillUnless(net.activations != NULL);
+    KillUnless(hn_small_recall_available(net, max_units, utils));
+    Logger("Specialised recall for %zu units\n", max_units);
+
+    switch (max_units) {
+    case 8:
+        return hn_small_recall_8(net, warning_threshold, utils.mode, rng);
+    case 16:
+        return hn_small_recall_16(net, warning_threshold, utils.mode, rng);
+    case 32:
+        return hn_small_recall_32(net, warning_threshold, utils.mode, rng);
+    default:
+        return hn_small_recall_64(net, warning_threshold, utils.mode, rng);
+    }
+}
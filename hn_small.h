@@ -0,0 +1,73 @@
+/*****************************************************
+ * HEADER FILE: hn_small.h                           *
+ * MODULE: Small networks                            *
+ *                                                   *
+ * FUNCTION: Asynchronous recall specialised at      *
+ *           compile time for networks of 8, 16, 32  *
+ *           and 64 units (state held in a bitmask)  *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_SMALL_H
+#define HN_SMALL_H
+
+#include "hn_types.h"
+
+#include <stdlib.h>
+
+
+
+/*
+ * hn_test_pattern (and hn_test_patterns_batch) switch to these recalls
+ * by themselves whenever one applies: the state of the network is kept
+ * in a single integer (bit i set iff unit i is +1), the weights in a
+ * local N * N array, and the loops over the units have constant bounds.
+ * The selection follows the standard utilities of the mode exactly
+ * (same units, same random draws, same number of updates).
+ */
+
+
+/**
+ * Whether a specialised recall exists for the given network size,
+ * weights format and utilities: sequential, random or random-permutation
+ * selection with the functions of hn_utils_with_mode(), and no
+ * annealing schedule.
+ *
+ * \param network      the Hopfield Network data structure
+ * \param max_units    the size of the network
+ * \param utils        the update mode and functions
+ *
+ * \return             1 if hn_small_recall() can be used, 0 otherwise
+ */
+int hn_small_recall_available(hn_network network, size_t max_units,
+                              hn_mode_utils utils);
+
+
+/**
+ * Asynchronous recall to convergence, with the same semantics as
+ * hn_test_pattern (see hn_small_recall_available() for the conditions).
+ *
+ * \param network              the Hopfield Network data structure, whose
+ *                             activations are updated in place
+ * \param max_units            the size of the network
+ * \param warning_threshold    consecutive stable updates before a check
+ * \param utils                the update mode and functions
+ * \param rng                  the generator of the random selections,
+ *                             already seeded (unused by MODE_SEQUENTIAL)
+ *
+ * \return                     the number of unit updates until convergence
+ */
+long hn_small_recall(hn_network network, size_t max_units,
+                     size_t warning_threshold, hn_mode_utils utils,
+                     hn_rng *rng);
+
+
+#endif /* HN_SMALL_H */
@@ -0,0 +1,240 @@
+/*****************************************************
+ * C FILE (main): hn_small_test.c                    *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the recalls specialised for    *
+ *           networks of 8, 16, 32 and 64 units with *
+ *           the generic ones, and times them        *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_small.h"
+#include "../hn_macro_utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PROBES 32
+#define FLIP_PROBABILITY 0.2
+#define RECALL_SEED 7
+#define TIMED_RECALLS 20000
+
+
+/* Wrappers of the standard selectors: hn_test_pattern can't recognise
+ * them, so they force the generic recall */
+static size_t generic_sequential(hn_dynamics *dynamics, size_t max_units,
+                                 int reset)
+{
+    return sequential_select_unit(dynamics, max_units, reset);
+}
+
+static size_t generic_random(hn_dynamics *dynamics, size_t max_units,
+                             int reset)
+{
+    return random_select_unit(dynamics, max_units, reset);
+}
+
+static size_t generic_permutation(hn_dynamics *dynamics, size_t max_units,
+                                  int reset)
+{
+    return permutation_select_unit(dynamics, max_units, reset);
+}
+
+
+static hn_mode_utils generic_utils(enum hn_mode mode)
+{
+    hn_mode_utils utils = hn_utils_with_mode(mode);
+    if (mode == MODE_RANDOM) {
+        utils.select_unit = &generic_random;
+    } else if (mode == MODE_RANDOM_PERMUTATION) {
+        utils.select_unit = &generic_permutation;
+    } else {
+        utils.select_unit = &generic_sequential;
+    }
+    return utils;
+}
+
+
+/* Recall all the probes with the specialised, generic and batched
+ * recalls, and count the probes whose outcomes differ */
+static size_t compare_recalls(hn_network net, spike_T **probes,
+                              size_t max_probes, size_t max_units,
+                              enum hn_mode mode)
+{
+    hn_mode_utils utils = hn_utils_with_mode(mode);
+    hn_mode_utils generic = generic_utils(mode);
+    size_t mismatches = !hn_small_recall_available(net, max_units, utils) +
+                        hn_small_recall_available(net, max_units, generic);
+    
+    spike_T **states[3];
+    long updates[3][MAX_PROBES];
+    for (int r = 0; r < 3; ++r) {
+        MatrixAlloc(states[r], max_probes, max_units);
+        for (size_t k = 0; k < max_probes; ++k) {
+            memcpy(states[r][k], probes[k], max_units * sizeof (spike_T));
+        }
+    }
+    
+    srand(RECALL_SEED);
+    for (size_t k = 0; k < max_probes; ++k) {
+        net.activations = states[0][k];
+        updates[0][k] = hn_test_pattern(net, NULL, max_units, max_units,
+                                        utils);
+    }
+    srand(RECALL_SEED);
+    for (size_t k = 0; k < max_probes; ++k) {
+        net.activations = states[1][k];
+        updates[1][k] = hn_test_pattern(net, NULL, max_units, max_units,
+                                        generic);
+    }
+    srand(RECALL_SEED);
+    net.activations = NULL;
+    hn_test_patterns_batch(net, states[2], max_probes, max_units, max_units,
+                           utils, updates[2]);
+    
+    for (size_t k = 0; k < max_probes; ++k) {
+        for (int r = 1; r < 3; ++r) {
+            mismatches += updates[r][k] != updates[0][k] ||
+                          hn_overlap_frequency(states[r][k], states[0][k],
+                                               max_units) != max_units;
+        }
+    }
+    
+    for (int r = 0; r < 3; ++r) {
+        MatrixFree(states[r]);
+    }
+    return mismatches;
+}
+
+
+/* Seconds taken by TIMED_RECALLS recalls of the probes (in turn) */
+static double time_recalls(hn_network net, spike_T **probes,
+                           size_t max_probes, size_t max_units,
+                           hn_mode_utils utils)
+{
+    spike_T *state = malloc(max_units * sizeof (spike_T));
+    KillUnless(state != NULL);
+    net.activations = state;
+    
+    clock_t clock_start = clock();
+    for (size_t r = 0; r < TIMED_RECALLS; ++r) {
+        memcpy(state, probes[r % max_probes], max_units * sizeof (spike_T));
+        hn_test_pattern(net, NULL, max_units, max_units, utils);
+    }
+    clock_t clock_end = clock();
+    
+    free(state);
+    return (double)(clock_end - clock_start) / CLOCKS_PER_SEC;
+}
+
+
+int main(int argc, char **argv)
+{
+    const size_t sizes[] = {8, 16, 32, 64};
+    const enum hn_mode modes[] = {MODE_SEQUENTIAL, MODE_RANDOM,
+                                  MODE_RANDOM_PERMUTATION};
+    const char *mode_names[] = {"MODE_SEQUENTIAL", "MODE_RANDOM",
+                                "MODE_RANDOM_PERMUTATION"};
+    const char *format_names[] = {"dense", "counts", "packed"};
+    size_t max_probes = MAX_PROBES;
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Recalls specialised for small networks\n\n");
+    
+    for (size_t s = 0; s < 4; ++s) {
+        size_t max_units = sizes[s];
+        size_t max_patterns = max_units / 8;
+        
+        spike_T **patterns;
+        MatrixAlloc(patterns, max_patterns, max_units);
+        for (size_t n = 0; n < max_patterns; ++n) {
+            hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+        }
+        spike_T **probes;
+        MatrixAlloc(probes, max_probes, max_units);
+        for (size_t k = 0; k < max_probes; ++k) {
+            for (size_t i = 0; i < max_units; ++i) {
+                probes[k][i] = patterns[k % max_patterns][i];
+                if ((double)rand() / RAND_MAX < FLIP_PROBABILITY) {
+                    probes[k][i] = -probes[k][i];
+                }
+            }
+        }
+        
+        double **weights;
+        MatrixAlloc(weights, max_units, max_units);
+        hn_hebb_weights_from_patterns(weights, patterns, max_patterns,
+                                      max_units, 1);
+        hn_count_weights counts;
+        MatrixAlloc(counts.counts, max_units, max_units);
+        hn_hebb_counts_from_patterns(&counts, patterns, max_patterns,
+                                     max_units, 1);
+        double *packed = malloc(PackedMatrixLength(max_units) *
+                                sizeof (double));
+        KillUnless(packed != NULL);
+        hn_pack_weights(packed, weights, max_units);
+        
+        hn_network networks[3];
+        networks[0] = hn_network_from_params(weights, 0., NULL);
+        networks[1] = hn_network_from_counts(counts, 0., NULL);
+        networks[2] = hn_network_from_packed(packed, 0., NULL);
+        
+        for (size_t m = 0; m < 3; ++m) {
+            for (size_t f = 0; f < 3; ++f) {
+                size_t mismatches = compare_recalls(networks[f], probes,
+                                                    max_probes, max_units,
+                                                    modes[m]);
+                printf("N = %2zu, %-23s %-6s weights: %s\n", max_units,
+                       mode_names[m], format_names[f],
+                       mismatches == 0 ? "identical" : "DIFFERENT");
+                failures += mismatches;
+            }
+        }
+        
+        double small_time = time_recalls(networks[0], probes, max_probes,
+                                         max_units,
+                                         hn_utils_with_mode(MODE_SEQUENTIAL));
+        double generic_time = time_recalls(networks[0], probes, max_probes,
+                                           max_units,
+                                           generic_utils(MODE_SEQUENTIAL));
+        printf("N = %2zu, %d sequential recalls: %.3f s specialised, "
+               "%.3f s generic\n\n", max_units, TIMED_RECALLS, small_time,
+               generic_time);
+        
+        free(packed);
+        MatrixFree(counts.counts);
+        MatrixFree(weights);
+        MatrixFree(probes);
+        MatrixFree(patterns);
+    }
+    
+    /* Other sizes keep the generic recall */
+    hn_network odd = hn_network_from_params(NULL, 0., NULL);
+    if (hn_small_recall_available(odd, 12,
+                                  hn_utils_with_mode(MODE_SEQUENTIAL))) {
+        printf("A network of 12 units has a specialised recall!\n");
+        ++failures;
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,169 @@
+/*****************************************************
+ * C FILE: hn_sparse.c                               *
+ * MODULE: Sparse (diluted) weights                  *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "debug_log.h"
+#include "hn_macro_utils.h"
+#include "hn_sparse.h"
+#include "hn_types.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+hn_sparse_weights hn_sparse_weights_alloc(size_t max_units,
+                                          size_t max_nonzeros)
+{
+    hn_sparse_weights weights;
+    /* (At least one element each, so that NULL means failure) */
+    weights.values = malloc(Max(max_nonzeros, 1) * sizeof (double));
+    weights.columns = malloc(Max(max_nonzeros, 1) * sizeof (uint32_t));
+    weights.row_starts = malloc((max_units + 1) * sizeof (size_t));
+    KillUnless(weights.values != NULL && weights.columns != NULL &&
+               weights.row_starts != NULL);
+    return weights;
+}
+
+
+void hn_sparse_weights_free(hn_sparse_weights weights)
+{
+    free(weights.values);
+    free(weights.columns);
+    free(weights.row_starts);
+}
+
+
+size_t hn_sparse_nonzeros(hn_sparse_weights weights, size_t max_units)
+{
+    return weights.row_starts[max_units];
+}
+
+
+int hn_dilution_mask(size_t i, size_t j, double connectivity, uint64_t seed)
+{
+    /* The unordered pair, mixed with the seed (SplitMix64 finaliser) */
+    uint64_t key = ((uint64_t)Min(i, j) << 32 | (uint64_t)Max(i, j)) ^ seed;
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    /* 53 random bits, as a double in [0, 1) */
+    return (double)(key >> 11) * 0x1.0p-53 < connectivity;
+}
+
+
+hn_sparse_weights hn_sparse_weights_with_mask(size_t max_units,
+                                              double connectivity,
+                                              uint64_t seed,
+                                              int remove_self_coupling)
+{
+    KillUnless(max_units <= UINT32_MAX);
+    
+    /* First pass over the upper triangle: count the synapses of each row */
+    size_t *row_lengths = calloc(max_units + 1, sizeof (size_t));
+    KillUnless(row_lengths != NULL);
+    for (size_t i = 0; i < max_units; ++i) {
+        row_lengths[i] += !remove_self_coupling;
+        for (size_t j = i + 1; j < max_units; ++j) {
+            if (hn_dilution_mask(i, j, connectivity, seed)) {
+                ++row_lengths[i];
+                ++row_lengths[j];
+            }
+        }
+    }
+    
+    size_t max_nonzeros = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        max_nonzeros += row_lengths[i];
+    }
+    hn_sparse_weights weights = hn_sparse_weights_alloc(max_units,
+                                                        max_nonzeros);
+    weights.row_starts[0] = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        weights.row_starts[i + 1] = weights.row_starts[i] + row_lengths[i];
+    }
+    
+    /* Second pass: each synapse (i, j) with i < j goes to both rows.
+     * Row j receives the columns i < j in increasing order before its own
+     * pass, which appends the diagonal and the columns beyond: the columns
+     * end up sorted. The row lengths become the insertion cursors. */
+    memcpy(row_lengths, weights.row_starts, max_units * sizeof (size_t));
+    size_t *cursors = row_lengths;
+    for (size_t i = 0; i < max_units; ++i) {
+        if (!remove_self_coupling) {
+            weights.columns[cursors[i]++] = (uint32_t)i;
+        }
+        for (size_t j = i + 1; j < max_units; ++j) {
+            if (hn_dilution_mask(i, j, connectivity, seed)) {
+                weights.columns[cursors[i]++] = (uint32_t)j;
+                weights.columns[cursors[j]++] = (uint32_t)i;
+            }
+        }
+    }
+    free(row_lengths);
+    
+    memset(weights.values, 0, Max(max_nonzeros, 1) * sizeof (double));
+    
+    Logger("Sparse weights: %zu synapses (%g of the full matrix)\n",
+           max_nonzeros, (double)max_nonzeros / max_units / max_units);
+    
+    return weights;
+}
+
+
+void hn_hebb_sparse_weights_from_patterns(hn_sparse_weights *weights,
+                                          spike_T **patterns,
+                                          int max_patterns, int max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t k = weights->row_starts[i]; k < weights->row_starts[i + 1];
+             ++k) {
+            size_t j = weights->columns[k];
+            int count = 0;
+            for (size_t n = 0; n < max_patterns; ++n) {
+                count += patterns[n][i] * patterns[n][j];
+            }
+            /* Normalise on number of units */
+            weights->values[k] = (double)count / max_units;
+        }
+    }
+}
+
+
+void hn_hebb_sparse_weights_increment_with_pattern(hn_sparse_weights *weights,
+                                                   spike_T *pattern,
+                                                   int max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t k = weights->row_starts[i]; k < weights->row_starts[i + 1];
+             ++k) {
+            /* Add (normalised) pattern autocorrelation */
+            weights->values[k] += pattern[i] * pattern[weights->columns[k]] /
+                                  (double)max_units;
+        }
+    }
+}
+
+
+void hn_sparse_to_dense(double **dense, hn_sparse_weights weights,
+                        size_t max_units)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        memset(dense[i], 0, max_units * sizeof (double));
+        for (size_t k = weights.row_starts[i]; k < weights.row_starts[i + 1];
+             ++k) {
+            dense[i][weights.columns[k]] = weights.values[k];
+        }
+    }
+}
@@ -0,0 +1,133 @@
+/*****************************************************
+ * HEADER FILE: hn_sparse.h                          *
+ * MODULE: Sparse (diluted) weights                  *
+ *                                                   *
+ * FUNCTION: Symmetric random dilution masks and     *
+ *           Hebbian learning on weight matrices     *
+ *           in CSR format                           *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_SPARSE_H
+#define HN_SPARSE_H
+
+#include "hn_types.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+
+/**
+ * Allocate the arrays of a CSR weight matrix (released by
+ * hn_sparse_weights_free()); the row offsets are not initialised.
+ *
+ * \param max_units      the size of the network
+ * \param max_nonzeros   the number of stored weights
+ *
+ * \return               the sparse weight matrix
+ */
+hn_sparse_weights hn_sparse_weights_alloc(size_t max_units,
+                                          size_t max_nonzeros);
+
+
+/**
+ * Free the arrays of a CSR weight matrix.
+ *
+ * \param weights    the sparse weight matrix
+ */
+void hn_sparse_weights_free(hn_sparse_weights weights);
+
+
+/**
+ * Number of stored weights of a CSR weight matrix.
+ *
+ * \param weights    the sparse weight matrix
+ * \param max_units  the size of the network
+ *
+ * \return           the number of nonzeros
+ */
+size_t hn_sparse_nonzeros(hn_sparse_weights weights, size_t max_units);
+
+
+/**
+ * Symmetric random dilution mask: whether the synapse between units i and j
+ * exists, decided by hashing the unordered pair with the seed, so that
+ * each one exists independently with probability connectivity.
+ *
+ * \param i              index of the first unit
+ * \param j              index of the second unit
+ * \param connectivity   the probability of a synapse (in [0, 1])
+ * \param seed           the seed of the mask
+ *
+ * \return               1 if the synapse exists, 0 otherwise
+ */
+int hn_dilution_mask(size_t i, size_t j, double connectivity, uint64_t seed);
+
+
+/**
+ * Create a CSR weight matrix holding the synapses of the dilution mask
+ * (with sorted columns in each row), with all the weights set to 0.;
+ * the diagonal is left out iff remove_self_coupling is non-zero.
+ *
+ * \param max_units             the size of the network
+ * \param connectivity          the probability of a synapse (in [0, 1])
+ * \param seed                  the seed of the mask
+ * \param remove_self_coupling  non-zero to suppress diagonal, 0 otherwise
+ *
+ * \return                      the sparse weight matrix (to be freed with
+ *                              hn_sparse_weights_free())
+ */
+hn_sparse_weights hn_sparse_weights_with_mask(size_t max_units,
+                                              double connectivity,
+                                              uint64_t seed,
+                                              int remove_self_coupling);
+
+
+/**
+ * Hebb's rule restricted to the stored synapses of a CSR weight matrix:
+ * the weight of each of them is set as in hn_hebb_weights_from_patterns()
+ * (normalised with 1./max_units), the others stay absent.
+ *
+ * \param weights        the sparse weight matrix (with its mask)
+ * \param patterns       list of spike_T patterns
+ * \param max_patterns   the number of patterns
+ * \param max_units      the size of the network
+ */
+void hn_hebb_sparse_weights_from_patterns(hn_sparse_weights *weights,
+                                          spike_T **patterns,
+                                          int max_patterns, int max_units);
+
+
+/**
+ * Incremental version of hn_hebb_sparse_weights_from_patterns().
+ *
+ * \param weights        the sparse weight matrix to be updated
+ * \param pattern        the pattern to be learnt
+ * \param max_units      the size of the network
+ */
+void hn_hebb_sparse_weights_increment_with_pattern(hn_sparse_weights *weights,
+                                                   spike_T *pattern,
+                                                   int max_units);
+
+
+/**
+ * Expand a CSR weight matrix into a full one (absent synapses are 0.).
+ *
+ * \param dense      the max_units * max_units matrix to be filled
+ * \param weights    the sparse weight matrix
+ * \param max_units  the size of the network
+ */
+void hn_sparse_to_dense(double **dense, hn_sparse_weights weights,
+                        size_t max_units);
+
+
+#endif /* HN_SPARSE_H */
@@ -0,0 +1,196 @@
+/*****************************************************
+ * C FILE (main): hn_sparse_test.c                   *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares learning, I/O and recall with  *
+ *           CSR weights to the ones with the full   *
+ *           (masked) weight matrix                  *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+#include "../hn_sparse.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 9
+#define MAX_TESTS 10
+#define CONNECTIVITY 0.05
+#define MASK_SEED 12345
+#define FLIP_PROBABILITY 0.05
+#define W_FILENAME "sparse_weights_test.bin"
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    /* Half-way between the possible values of the fields: no ties */
+    double threshold = 0.5 / MAX_UNITS;
+    int same;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Sparse (CSR) vs. full weights\n"
+           "Number of units = %d, number of patterns = %d, "
+           "connectivity = %g\n\n", MAX_UNITS, MAX_PATTERNS, CONNECTIVITY);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    /* The mask: symmetric, with the expected density, sorted rows */
+    hn_sparse_weights sparse = hn_sparse_weights_with_mask(max_units,
+                                                           CONNECTIVITY,
+                                                           MASK_SEED, 1);
+    size_t max_nonzeros = hn_sparse_nonzeros(sparse, max_units);
+    double density = (double)max_nonzeros / (max_units * (max_units - 1));
+    same = fabs(density - CONNECTIVITY) < 0.005;
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t k = sparse.row_starts[i]; k < sparse.row_starts[i + 1];
+             ++k) {
+            same = same && sparse.columns[k] != i &&
+                   hn_dilution_mask(sparse.columns[k], i, CONNECTIVITY,
+                                    MASK_SEED) &&
+                   (k == sparse.row_starts[i] ||
+                    sparse.columns[k - 1] < sparse.columns[k]);
+        }
+    }
+    printf("Mask: %zu synapses (density %.4f): %s\n", max_nonzeros, density,
+           same ? "consistent" : "INCONSISTENT");
+    failures += !same;
+    
+    /* Learning: the masked full matrix */
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            if (i == j || !hn_dilution_mask(i, j, CONNECTIVITY, MASK_SEED)) {
+                weights[i][j] = 0.;
+            }
+        }
+    }
+    double **expanded;
+    MatrixAlloc(expanded, max_units, max_units);
+    hn_hebb_sparse_weights_from_patterns(&sparse, patterns, max_patterns,
+                                         max_units);
+    hn_sparse_to_dense(expanded, sparse, max_units);
+    same = 1;
+    for (size_t i = 0; i < max_units; ++i) {
+        same = same && !memcmp(weights[i], expanded[i],
+                               max_units * sizeof (double));
+    }
+    printf("Learning from patterns: %s\n", same ? "identical" : "DIFFERENT");
+    failures += !same;
+    
+    /* Save and read back */
+    hn_sparse_weights read_back;
+    same = hn_save_sparse_weights(sparse, W_FILENAME, max_units) == IOSuccess &&
+           hn_read_sparse_weights(&read_back, W_FILENAME, max_units) == IOSuccess;
+    if (same) {
+        same = !memcmp(sparse.row_starts, read_back.row_starts,
+                       (max_units + 1) * sizeof (size_t)) &&
+               !memcmp(sparse.columns, read_back.columns,
+                       max_nonzeros * sizeof (uint32_t)) &&
+               !memcmp(sparse.values, read_back.values,
+                       max_nonzeros * sizeof (double));
+        hn_sparse_weights_free(read_back);
+    }
+    printf("Save and read back: %s\n", same ? "identical" : "DIFFERENT");
+    failures += !same;
+    /* A smaller network can't read it */
+    same = hn_read_sparse_weights(&read_back, W_FILENAME, max_units / 2) ==
+           IOFailure;
+    printf("Wrong size rejected: %s\n", same ? "yes" : "NO");
+    failures += !same;
+    
+    /* Files that would silently corrupt the recalls: two columns of a row
+     * swapped, then a column repeated, then an asymmetric weight */
+    size_t row = 0;
+    while (sparse.row_starts[row + 1] - sparse.row_starts[row] < 2) {
+        ++row;
+    }
+    size_t k = sparse.row_starts[row];
+    uint32_t first_column = sparse.columns[k];
+    uint32_t second_column = sparse.columns[k + 1];
+    double first_value = sparse.values[k];
+    sparse.columns[k] = second_column;
+    sparse.columns[k + 1] = first_column;
+    same = hn_save_sparse_weights(sparse, W_FILENAME, max_units) == IOSuccess &&
+           hn_read_sparse_weights(&read_back, W_FILENAME, max_units) ==
+           IOFailure;
+    sparse.columns[k] = second_column;
+    same = same &&
+           hn_save_sparse_weights(sparse, W_FILENAME, max_units) == IOSuccess &&
+           hn_read_sparse_weights(&read_back, W_FILENAME, max_units) ==
+           IOFailure;
+    sparse.columns[k] = first_column;
+    sparse.columns[k + 1] = second_column;
+    sparse.values[k] = first_value + 1.;
+    same = same &&
+           hn_save_sparse_weights(sparse, W_FILENAME, max_units) == IOSuccess &&
+           hn_read_sparse_weights(&read_back, W_FILENAME, max_units) ==
+           IOFailure;
+    sparse.values[k] = first_value;
+    printf("Unsorted, repeated and asymmetric rejected: %s\n\n",
+           same ? "yes" : "NO");
+    failures += !same;
+    remove(W_FILENAME);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_SEQUENTIAL);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n % max_patterns],
+                                        FLIP_PROBABILITY, max_units);
+        spike_T *sparse_probe = hn_pattern_copy(probe, max_units);
+        
+        hn_network net = hn_network_from_params(weights, threshold, probe);
+        long updates = hn_test_pattern(net, NULL, max_units, max_units, utils);
+        hn_network sparse_net = hn_network_from_sparse(sparse, threshold,
+                                                       sparse_probe);
+        long sparse_updates = hn_test_pattern(sparse_net, NULL, max_units,
+                                              max_units, utils);
+        size_t overlaps = hn_overlap_frequency(probe, sparse_probe, max_units);
+        
+        printf("Probe %zu: updates = %ld (sparse: %ld); "
+               "final states overlap = %zu/%zu\n",
+               n, updates, sparse_updates, overlaps, max_units);
+        failures += overlaps != max_units || updates != sparse_updates;
+        
+        free(probe);
+        free(sparse_probe);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    hn_sparse_weights_free(sparse);
+    MatrixFree(expanded);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
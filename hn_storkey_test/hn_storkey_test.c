@@ -0,0 +1,200 @@
+/*****************************************************
+ * C FILE (main): hn_storkey_test.c                  *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Compares the O(N^2) Storkey updates     *
+ *           with the direct O(N^3) rule, checks     *
+ *           that they store more patterns than the  *
+ *           Hebb rule, and times them               *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_kernels.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CAPACITY_UNITS 200
+#define CAPACITY_PATTERNS 40
+#define TIMED_UNITS 2000
+#define TIMED_PATTERNS 20
+
+
+/* The rule as stated: h_ij = sum_{k != i,j} w_ik x_k is summed for every
+ * entry, from a copy of the old weights */
+static void naive_storkey_increment(double **weights, double **old_weights,
+                                    spike_T *pattern, size_t max_units,
+                                    int remove_self_coupling)
+{
+    for (size_t i = 0; i < max_units; ++i) {
+        memcpy(old_weights[i], weights[i], max_units * sizeof (double));
+    }
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            double h_ij = 0., h_ji = 0.;
+            for (size_t k = 0; k < max_units; ++k) {
+                if (k != i && k != j) {
+                    h_ij += old_weights[i][k] * pattern[k];
+                    h_ji += old_weights[j][k] * pattern[k];
+                }
+            }
+            weights[i][j] += (pattern[i] * pattern[j] - pattern[i] * h_ji -
+                              h_ij * pattern[j]) / (double)max_units;
+        }
+        if (remove_self_coupling) {
+            weights[i][i] = 0.;
+        }
+    }
+}
+
+
+/* Learn random patterns with the direct rule and with the fast ones
+ * (one by one, at once, and from scratch): the results must agree up
+ * to rounding and be exactly symmetric */
+static size_t check_size(size_t max_units, size_t max_patterns)
+{
+    size_t failures = 0;
+    spike_T **patterns;
+    MatrixAlloc(patterns, Max(max_patterns, 1), max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    double **expected, **old_weights, **weights;
+    MatrixAlloc(expected, max_units, max_units);
+    MatrixAlloc(old_weights, max_units, max_units);
+    MatrixAlloc(weights, max_units, max_units);
+
+    for (int self = 0; self <= 1; ++self) {
+        for (size_t i = 0; i < max_units; ++i) {
+            memset(expected[i], 0, max_units * sizeof (double));
+            memset(weights[i], 0, max_units * sizeof (double));
+        }
+        for (size_t n = 0; n < max_patterns; ++n) {
+            naive_storkey_increment(expected, old_weights, patterns[n],
+                                    max_units, self);
+            hn_storkey_weights_increment_with_pattern(weights, patterns[n],
+                                                      max_units, self);
+        }
+        double one_by_one = max_difference(weights, expected, max_units);
+        size_t asymmetries = count_asymmetries(weights, max_units);
+
+        hn_storkey_weights_from_patterns(weights, patterns, max_patterns,
+                                         max_units, self);
+        double from_scratch = max_difference(weights, expected, max_units);
+        asymmetries += count_asymmetries(weights, max_units);
+
+        /* Half of the patterns one by one, then the rest at once */
+        size_t first = max_patterns / 2;
+        for (size_t i = 0; i < max_units; ++i) {
+            memset(weights[i], 0, max_units * sizeof (double));
+        }
+        for (size_t n = 0; n < first; ++n) {
+            hn_storkey_weights_increment_with_pattern(weights, patterns[n],
+                                                      max_units, self);
+        }
+        hn_storkey_weights_increment_with_patterns(weights, patterns + first,
+                                                   max_patterns - first,
+                                                   max_units, self);
+        double incremental = max_difference(weights, expected, max_units);
+        asymmetries += count_asymmetries(weights, max_units);
+
+        printf("N = %4zu, P = %3zu, %s self-coupling: difference %g "
+               "(one by one), %g (from scratch), %g (incremental); "
+               "%zu asymmetric entries\n", max_units, max_patterns,
+               self ? "without" : "with", one_by_one, from_scratch,
+               incremental, asymmetries);
+        failures += one_by_one > 1e-12 || from_scratch > 1e-12 ||
+                    incremental > 1e-12 || asymmetries != 0;
+    }
+
+    MatrixFree(weights);
+    MatrixFree(old_weights);
+    MatrixFree(expected);
+    MatrixFree(patterns);
+    return failures;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t failures = 0;
+
+    srand(1);
+
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Storkey learning rule (%s kernels)\n\n", hn_kernels_isa());
+
+    /* Sizes that are not multiples of the vectors, and tiny ones */
+    failures += check_size(1, 3);
+    failures += check_size(5, 0);
+    failures += check_size(37, 11);
+    failures += check_size(64, 20);
+    failures += check_size(101, 15);
+
+    /* Beyond the capacity of the Hebb rule (about 0.14 N) */
+    spike_T **patterns;
+    MatrixAlloc(patterns, TIMED_PATTERNS + CAPACITY_PATTERNS, TIMED_UNITS);
+    for (size_t n = 0; n < CAPACITY_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, CAPACITY_UNITS);
+    }
+    double **weights;
+    MatrixAlloc(weights, TIMED_UNITS, TIMED_UNITS);
+
+    hn_hebb_weights_from_patterns(weights, patterns, CAPACITY_PATTERNS,
+                                  CAPACITY_UNITS, 1);
+    size_t hebb_fixed_points = count_fixed_points(weights, patterns,
+                                                  CAPACITY_PATTERNS,
+                                                  CAPACITY_UNITS);
+    hn_storkey_weights_from_patterns(weights, patterns, CAPACITY_PATTERNS,
+                                     CAPACITY_UNITS, 1);
+    size_t storkey_fixed_points = count_fixed_points(weights, patterns,
+                                                     CAPACITY_PATTERNS,
+                                                     CAPACITY_UNITS);
+    printf("\nN = %d, P = %d: %zu patterns are fixed points (Hebb), "
+           "%zu (Storkey)\n", CAPACITY_UNITS, CAPACITY_PATTERNS,
+           hebb_fixed_points, storkey_fixed_points);
+    failures += storkey_fixed_points != CAPACITY_PATTERNS ||
+                hebb_fixed_points >= storkey_fixed_points;
+
+    for (size_t n = 0; n < TIMED_PATTERNS; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, TIMED_UNITS);
+    }
+    clock_t clock_start = clock();
+    for (size_t n = 0; n < TIMED_PATTERNS; ++n) {
+        hn_storkey_weights_increment_with_pattern(weights, patterns[n],
+                                                  TIMED_UNITS, 1);
+    }
+    clock_t clock_middle = clock();
+    hn_storkey_weights_from_patterns(weights, patterns, TIMED_PATTERNS,
+                                     TIMED_UNITS, 1);
+    clock_t clock_end = clock();
+
+    printf("\nN = %d, P = %d (CPU time of all threads): %.3f s (one by one), "
+           "%.3f s (from scratch)\n", TIMED_UNITS, TIMED_PATTERNS,
+           (double)(clock_middle - clock_start) / CLOCKS_PER_SEC,
+           (double)(clock_end - clock_middle) / CLOCKS_PER_SEC);
+
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+
+    MatrixFree(weights);
+    MatrixFree(patterns);
+
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
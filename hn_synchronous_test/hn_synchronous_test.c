@@ -0,0 +1,129 @@
+/*****************************************************
+ * C FILE (main): hn_synchronous_test.c              *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks the synchronous dynamics: fixed  *
+ *           points, 2-cycles and agreement of the   *
+ *           different weight formats                *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Even size and odd number of patterns: no field is ever 0 */
+#define MAX_UNITS 300
+#define MAX_PATTERNS 21
+#define MAX_TESTS 10
+#define FLIP_PROBABILITY 0.1
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    int has_cycled;
+    long sweeps;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Synchronous dynamics\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    /* Two mutually inhibiting units started in the same state
+     * swap between (+1,+1) and (-1,-1) forever */
+    double **inhibition;
+    MatrixZeros(inhibition, 2, 2);
+    inhibition[0][1] = inhibition[1][0] = -1.;
+    spike_T pair[2] = {+1, +1};
+    sweeps = hn_test_pattern_synchronous(hn_network_from_params(inhibition,
+                                                                0., pair),
+                                         NULL, 2, 0, &has_cycled);
+    printf("Mutual inhibition: sweeps = %ld, 2-cycle: %s\n", sweeps,
+           has_cycled ? "yes" : "NO");
+    failures += !has_cycled || sweeps != 2;
+    MatrixFree(inhibition);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    double *packed = malloc(PackedMatrixLength(max_units) * sizeof (double));
+    KillUnless(packed != NULL);
+    hn_pack_weights(packed, weights, max_units);
+    
+    hn_mode_utils utils = hn_utils_with_mode(MODE_SYNCHRONOUS);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *counts_probe = hn_pattern_copy(probe, max_units);
+        spike_T *packed_probe = hn_pattern_copy(probe, max_units);
+        
+        sweeps = hn_test_pattern_synchronous(hn_network_from_params(weights,
+                                                                    0., probe),
+                                             NULL, max_units, 0, &has_cycled);
+        long counts_updates = hn_test_pattern(hn_network_from_counts(counts, 0.,
+                                                                     counts_probe),
+                                              NULL, max_units, max_units, utils);
+        long packed_updates = hn_test_pattern(hn_network_from_packed(packed, 0.,
+                                                                     packed_probe),
+                                              NULL, max_units, max_units, utils);
+        size_t retrieved = hn_overlap_frequency(probe, patterns[n], max_units);
+        
+        printf("Probe %zu: sweeps = %ld%s; retrieved %zu/%zu\n", n, sweeps,
+               has_cycled ? " (2-cycle)" : "", retrieved, max_units);
+        failures += hn_overlap_frequency(probe, counts_probe, max_units) !=
+                    max_units || counts_updates != sweeps * max_units;
+        failures += hn_overlap_frequency(probe, packed_probe, max_units) !=
+                    max_units || packed_updates != sweeps * max_units;
+        
+        /* The memory itself is a fixed point */
+        sweeps = hn_test_pattern_synchronous(hn_network_from_params(weights,
+                                                                    0.,
+                                                                    patterns[n]),
+                                             NULL, max_units, 0, &has_cycled);
+        failures += sweeps != 0 || has_cycled;
+        
+        free(probe);
+        free(counts_probe);
+        free(packed_probe);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    free(packed);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,175 @@
+/*****************************************************
+ * HEADER FILE: hn_test_checks.h                     *
+ * MODULE: Test programs                             *
+ *                                                   *
+ * FUNCTION: Checks shared by the test programs,     *
+ *           computed from scratch (independently of *
+ *           the cached fields of the recalls), and  *
+ *           the corrupted probes they start from    *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#ifndef HN_TEST_CHECKS_H
+#define HN_TEST_CHECKS_H
+
+#include "debug_log.h"
+#include "hn_types.h"
+#include "hn_kernels.h"
+#include "hn_macro_utils.h"
+#include "hn_network.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+
+/**
+ * Copy a pattern, flipping each unit with the given probability
+ * (drawn with rand(), so srand() makes the probes reproducible).
+ *
+ * \param pattern           the pattern to be corrupted
+ * \param flip_probability  the probability of flipping each unit
+ * \param max_units         the size of the network
+ *
+ * \return                  the corrupted copy (freed by user)
+ */
+static inline spike_T *corrupted_copy(spike_T *pattern,
+                                      double flip_probability,
+                                      size_t max_units)
+{
+    spike_T *probe = hn_pattern_copy(pattern, max_units);
+    for (size_t i = 0; i < max_units; ++i) {
+        if ((double)rand() / RAND_MAX < flip_probability) {
+            probe[i] = -probe[i];
+        }
+    }
+    return probe;
+}
+
+
+/**
+ * Number of units that would flip if updated (threshold 0), with the
+ * local fields summed naively.
+ *
+ * \param weights      the weight matrix
+ * \param state        the state of the network
+ * \param max_units    the size of the network
+ *
+ * \return             the number of unstable units
+ */
+static inline size_t unstable_units(double **weights, spike_T *state,
+                                    size_t max_units)
+{
+    size_t unstable = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        double local_field = 0.;
+        for (size_t j = 0; j < max_units; ++j) {
+            local_field += weights[i][j] * state[j];
+        }
+        unstable += UnitIsUnstable(local_field, state[i], 0.);
+    }
+    return unstable;
+}
+
+
+/**
+ * Number of patterns that are fixed points of the dynamics (threshold 0).
+ *
+ * \param weights      the weight matrix
+ * \param patterns     list of spike_T patterns
+ * \param max_patterns the number of patterns
+ * \param max_units    the size of the network
+ *
+ * \return             the number of stable patterns
+ */
+static inline size_t count_fixed_points(double **weights, spike_T **patterns,
+                                        size_t max_patterns, size_t max_units)
+{
+    size_t fixed_points = 0;
+    double *local_fields = malloc(max_units * sizeof (double));
+    KillUnless(local_fields != NULL);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_local_fields(local_fields, weights, patterns[n], max_units);
+        size_t unstable = 0;
+        for (size_t i = 0; i < max_units; ++i) {
+            unstable += (local_fields[i] >= 0) != (patterns[n][i] == +1);
+        }
+        fixed_points += unstable == 0;
+    }
+    free(local_fields);
+    return fixed_points;
+}
+
+
+/**
+ * Number of entries of a weight matrix that differ from their transposed.
+ *
+ * \param weights      the weight matrix
+ * \param max_units    the size of the network
+ *
+ * \return             the number of asymmetric pairs
+ */
+static inline size_t count_asymmetries(double **weights, size_t max_units)
+{
+    size_t asymmetries = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            asymmetries += weights[i][j] != weights[j][i];
+        }
+    }
+    return asymmetries;
+}
+
+
+/**
+ * Largest absolute difference between two weight matrices.
+ *
+ * \param a            first matrix
+ * \param b            second matrix
+ * \param max_units    the size of the network
+ *
+ * \return             the maximum of |a_ij - b_ij|
+ */
+static inline double max_difference(double **a, double **b, size_t max_units)
+{
+    double difference = 0.;
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            difference = Max(difference, fabs(a[i][j] - b[i][j]));
+        }
+    }
+    return difference;
+}
+
+
+/**
+ * Number of entries where two count matrices differ.
+ *
+ * \param a            first matrix
+ * \param b            second matrix
+ * \param max_units    the size of the network
+ *
+ * \return             the number of different entries
+ */
+static inline size_t count_mismatches(count_T **a, count_T **b,
+                                      size_t max_units)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < max_units; ++i) {
+        for (size_t j = 0; j < max_units; ++j) {
+            mismatches += a[i][j] != b[i][j];
+        }
+    }
+    return mismatches;
+}
+
+
+#endif /* HN_TEST_CHECKS_H */
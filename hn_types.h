@@ -17,6 +17,7 @@
 #ifndef HN_TYPES_H
 #define HN_TYPES_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 
@@ -27,12 +28,40 @@
 typedef int spike_T;
 
 
+/**
+ * Word of a bit-packed pattern: bit i%64 of word i/64 is set iff unit i
+ * is active (+1); the padding bits of the last word are always 0.
+ */
+typedef uint64_t packed_spikes_T;
+
+#define SPIKES_PER_WORD 64
+
+
+/**
+ * Integer type of the synaptic counts of hn_count_weights: 16 bits by
+ * default, 8 bits if compiled with -D HN_COUNT_INT8 (enough for Hebbian
+ * networks that learn at most 127 patterns).
+ */
+#ifdef HN_COUNT_INT8
+typedef int8_t count_T;
+#  define COUNT_MAX INT8_MAX
+#else
+typedef int16_t count_T;
+#  define COUNT_MAX INT16_MAX
+#endif
+
+
 /**
  * Update mode: the way that a neuron is selected for update at each iteration.
  */
 enum hn_mode {
     MODE_SEQUENTIAL,            /* Th next unit according to index order is selected */
-    MODE_RANDOM                 /* A random unit is selected ("with replacement") */
+    MODE_RANDOM,                /* A random unit is selected ("with replacement") */
+    MODE_SYNCHRONOUS,           /* All units are updated at once (Little dynamics) */
+    MODE_PARALLEL,              /* Threads update disjoint blocks of units concurrently */
+    MODE_WORKLIST,              /* A random unit among the unstable ones is selected */
+    MODE_GREEDY,                /* The most unstable unit is selected */
+    MODE_RANDOM_PERMUTATION     /* Sweeps over the units in a shuffled order */
 };
 
 
@@ -52,6 +81,45 @@ typedef struct hn_options {
 } hn_options;
 
 
+/**
+ * Weight matrix stored as integer counts with a single global scale:
+ * Hebbian weights are always k/max_units with integer k, hence exact.
+ */
+typedef struct hn_count_weights {
+
+    count_T **counts;       /* matrix of size max_units * max_units */
+    double scale;           /* each weight is counts[i][j] * scale */
+
+} hn_count_weights;
+
+
+/**
+ * Weight matrix in compressed sparse row (CSR) format: the nonzero
+ * weights of row i are values[row_starts[i] .. row_starts[i+1]-1], in
+ * the columns listed at the same positions of columns, in strictly
+ * increasing order. The pattern of nonzeros must be symmetric (as the
+ * weights).
+ */
+typedef struct hn_sparse_weights {
+
+    double *values;         /* nonzero weights, row after row */
+    uint32_t *columns;      /* column of each of the values */
+    size_t *row_starts;     /* vector of length max_units + 1 */
+
+} hn_sparse_weights;
+
+
+/**
+ * Representation of the weights in the hn_network structure.
+ */
+enum hn_weights_format {
+    WEIGHTS_DENSE,              /* double matrix in hn_network.weights */
+    WEIGHTS_COUNTS,             /* integer matrix in hn_network.counts */
+    WEIGHTS_PACKED,             /* upper triangle in hn_network.packed_weights */
+    WEIGHTS_SPARSE              /* CSR matrix in hn_network.sparse */
+};
+
+
 /**
  * A simple collection of the main parameters that describe the Network.
  * Used to pass the information more compactly.
@@ -61,10 +129,117 @@ typedef struct hn_network {
     double **weights;       /* matrix of size max_units * max_units */
     spike_T *activations;   /* vector of length max_units */
     double threshold;       /* common threshold to all the units */
+    enum hn_weights_format format;  /* which of the weight fields is used */
+    hn_count_weights counts;        /* integer weights (WEIGHTS_COUNTS) */
+    double *packed_weights;         /* packed upper triangle (WEIGHTS_PACKED) */
+    hn_sparse_weights sparse;       /* CSR weights (WEIGHTS_SPARSE) */
 
 } hn_network;
 
 
+/**
+ * Hopfield Network whose Hebbian weights are never materialised: the
+ * stored patterns are kept instead, transposed so that row i lists the
+ * activations of unit i in every pattern, and the local field of unit i
+ * is (1/max_units) * sum_n patterns[n][i] * overlap_n, where overlap_n is
+ * the dot product of the current state with the n-th pattern.
+ */
+typedef struct hn_lowrank_network {
+
+    int8_t *unit_patterns;      /* matrix of size max_units * pattern_capacity */
+    size_t pattern_capacity;    /* row stride of unit_patterns */
+    size_t max_patterns;        /* number of stored patterns */
+    int remove_self_coupling;   /* non-zero to suppress the diagonal */
+    spike_T *activations;       /* vector of length max_units */
+    double threshold;           /* common threshold to all the units */
+
+} hn_lowrank_network;
+
+
+/**
+ * Record of the Lyapunov energy E = -1/2 s^T W s + threshold * sum_i s_i
+ * along a recall (see hn_test_pattern_with_energy): the energy at the
+ * start is followed by the one after each flip, as long as there is room.
+ */
+typedef struct hn_energy_trace {
+
+    double *energies;       /* vector of length max_energies (or NULL) */
+    size_t max_energies;    /* capacity of energies */
+    size_t length;          /* number of energies recorded */
+    double initial_energy;  /* energy of the initial state */
+    double final_energy;    /* energy of the final state */
+
+} hn_energy_trace;
+
+
+/**
+ * Annealing schedule of the finite-temperature (Glauber) dynamics: at
+ * temperature T a selected unit becomes +1 with probability
+ * 1 / (1 + exp(-2 (field - threshold) / T)). max_stages temperatures are
+ * visited, starting from initial_temperature and multiplying it by
+ * cooling_factor after each stage, with sweeps_per_stage * max_units
+ * updates at each of them. Both initial_temperature and cooling_factor
+ * must be positive, and the temperature of the last stage must not
+ * underflow to 0 (nor be so small that 1 / T overflows): the recall is
+ * killed otherwise.
+ */
+typedef struct hn_anneal_schedule {
+
+    double initial_temperature; /* temperature of the first stage */
+    double cooling_factor;      /* ratio of successive temperatures */
+    size_t max_stages;          /* number of temperatures */
+    size_t sweeps_per_stage;    /* sweeps of max_units updates at each one */
+    int quench;                 /* if non-zero, finish at zero temperature */
+
+} hn_anneal_schedule;
+
+
+/**
+ * State of a xoshiro256** pseudo-random number generator (see hn_rng.h).
+ */
+typedef struct hn_rng {
+
+    uint64_t state[4];      /* must not be all zero */
+
+} hn_rng;
+
+
+/**
+ * The state of a recall in progress, maintained by hn_test_pattern:
+ * the cached local fields and the number of units that would flip
+ * if they were updated (the network has converged iff this is 0).
+ * With integer weights the fields are kept unscaled (hence exact)
+ * and the threshold is divided by the scale instead.
+ * With MODE_WORKLIST the unstable units are also listed (in no particular
+ * order), and each unit knows its position in the list.
+ * With MODE_GREEDY all the units are kept in a binary max-heap, unstable
+ * units first and then by violation -activation * (field - threshold).
+ * With MODE_RANDOM_PERMUTATION each sweep visits the units in the order
+ * of a fresh shuffle, drawn from the generator of the recall.
+ * The state of the selection and stability utilities (hn_mode_utils) is
+ * kept here as well, so that recalls can run concurrently.
+ * If an energy trace is given, the energy (in the same units as the
+ * fields) is updated in O(1) at each flip.
+ */
+typedef struct hn_dynamics {
+
+    double *local_fields;   /* vector of length max_units */
+    double threshold;       /* the threshold, in the same units as the fields */
+    size_t unstable_units;  /* units whose activation disagrees with their field */
+    size_t *worklist;       /* the unstable_units unstable units (or NULL) */
+    size_t *worklist_positions; /* index in worklist of each unit, or max_units */
+    size_t *heap;           /* all the units, most unstable first (or NULL) */
+    size_t *heap_positions; /* index in heap of each unit */
+    size_t *permutation;    /* visiting order of the current sweep (or NULL) */
+    size_t selector_position;   /* updates since the start of the sweep */
+    size_t stability_counter;   /* consecutive updates with no flip */
+    hn_rng rng;             /* generator of the random selections */
+    double energy;          /* energy of the current state, if traced */
+    hn_energy_trace *trace; /* where the energy is recorded (or NULL) */
+
+} hn_dynamics;
+
+
 /**
  * Collection of function pointers to utility functions to be used by
  * hn_test_pattern and take into account how the next unit is to be selected
@@ -72,16 +247,30 @@ typedef struct hn_network {
  */
 typedef struct hn_mode_utils {
 
-    /* Generates the next index of the next unit to update. It could have
-     * an internal state that can be reset with the boolean reset */
-    size_t (*select_unit)(size_t max_units, int reset);
+    /* The update mode: with MODE_SYNCHRONOUS and MODE_PARALLEL,
+     * hn_test_pattern performs whole sweeps and the following functions
+     * are not used (but for the sequential completion of the latter) */
+    enum hn_mode mode;
+
+    /* Generates the next index of the next unit to update. Its position
+     * (or generator) is kept in the state of the recall, and is reset
+     * with the boolean reset */
+    size_t (*select_unit)(hn_dynamics *dynamics, size_t max_units,
+                          int reset);
+
+    /* If not NULL, the units are first updated with the Glauber rule
+     * at finite temperature (only with MODE_SEQUENTIAL, MODE_RANDOM and
+     * MODE_RANDOM_PERMUTATION); set to NULL by hn_utils_with_mode() */
+    const hn_anneal_schedule *schedule;
 
     /* Signals whether we should test for convergence, that is,
-     * use stability_check() */
-    int (*stability_warning)(int unit_has_flipped, size_t threshold);
+     * use stability_check(); its counter is kept in the recall state */
+    int (*stability_warning)(hn_dynamics *dynamics, int unit_has_flipped,
+                             size_t threshold);
 
-    /* Determines whether the network has converged */
-    int (*stability_check)(hn_network, size_t max_units);
+    /* Determines whether the network has converged (from the state
+     * maintained by hn_test_pattern, hence in O(1)) */
+    int (*stability_check)(const hn_dynamics *dynamics, size_t max_units);
 
 } hn_mode_utils;
 
@@ -0,0 +1,136 @@
+/*****************************************************
+ * C FILE (main): hn_worklist_test.c                 *
+ * MODULE: Main application (test)                   *
+ *                                                   *
+ * FUNCTION: Checks that the recall drawing from the *
+ *           list of unstable units ends in a stable *
+ *           state, flipping a unit at every update  *
+ *                                                   *
+ * PROJECT NAME: Hopfield Network simulation         *
+ *               (prototype)                         *
+ *                                                   *
+ * SUPERVISOR: Mark van Rossum                       *
+ *                                                   *
+ * AUTHOR:  Lorenzo Mella                            *
+ *                                                   *
+ *****************************************************/
+
+
+#include "../debug_log.h"
+#include "../hn_types.h"
+#include "../hn_data_io.h"
+#include "../hn_network.h"
+#include "../hn_modes.h"
+#include "../hn_sparse.h"
+#include "../hn_macro_utils.h"
+#include "../hn_test_checks.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define MAX_UNITS 1000
+#define MAX_PATTERNS 50
+#define MAX_TESTS 10
+#define CONNECTIVITY 0.5
+#define FLIP_PROBABILITY 0.1
+
+
+/* Recall from a copy of the probe: the final state must be stable and,
+ * as every update flips a unit, the number of updates must have the
+ * parity of the number of units that differ from the probe */
+static size_t check_recall(hn_network net, double **weights, spike_T *probe,
+                           spike_T *memory, size_t max_units,
+                           const char *label)
+{
+    spike_T *initial = hn_pattern_copy(probe, max_units);
+    net.activations = probe;
+    long updates = hn_test_pattern(net, NULL, max_units, max_units,
+                                   hn_utils_with_mode(MODE_WORKLIST));
+    size_t changed = max_units - hn_overlap_frequency(initial, probe,
+                                                      max_units);
+    size_t unstable = unstable_units(weights, probe, max_units);
+    size_t retrieved = hn_overlap_frequency(probe, memory, max_units);
+    
+    printf("  %-8s updates = %ld; changed units = %zu; unstable units = %zu; "
+           "retrieved %zu/%zu\n", label, updates, changed, unstable,
+           retrieved, max_units);
+    
+    free(initial);
+    return unstable != 0 || updates < (long)changed ||
+           (updates - (long)changed) % 2 != 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t max_units = MAX_UNITS;
+    size_t max_patterns = MAX_PATTERNS;
+    size_t failures = 0;
+    
+    srand(1);
+    
+    printf("\n- Hopfield Network simulation -\n\n"
+           "Recall from the list of unstable units (MODE_WORKLIST)\n"
+           "Number of units = %d, number of patterns = %d\n\n",
+           MAX_UNITS, MAX_PATTERNS);
+    
+    spike_T **patterns;
+    MatrixAlloc(patterns, max_patterns, max_units);
+    for (size_t n = 0; n < max_patterns; ++n) {
+        hn_fill_rand_pattern(patterns[n], 0.5, max_units);
+    }
+    
+    double **weights;
+    MatrixAlloc(weights, max_units, max_units);
+    hn_hebb_weights_from_patterns(weights, patterns, max_patterns, max_units, 1);
+    hn_count_weights counts;
+    MatrixAlloc(counts.counts, max_units, max_units);
+    hn_hebb_counts_from_patterns(&counts, patterns, max_patterns, max_units, 1);
+    
+    /* Diluted weights, expanded to check the final state */
+    hn_sparse_weights sparse = hn_sparse_weights_with_mask(max_units,
+                                                           CONNECTIVITY, 1, 1);
+    hn_hebb_sparse_weights_from_patterns(&sparse, patterns, max_patterns,
+                                         max_units);
+    double **sparse_dense;
+    MatrixAlloc(sparse_dense, max_units, max_units);
+    hn_sparse_to_dense(sparse_dense, sparse, max_units);
+    
+    for (size_t n = 0; n < MAX_TESTS; ++n) {
+        /* Corrupt a stored pattern */
+        spike_T *probe = corrupted_copy(patterns[n], FLIP_PROBABILITY,
+                                        max_units);
+        spike_T *dense_probe = hn_pattern_copy(probe, max_units);
+        spike_T *counts_probe = hn_pattern_copy(probe, max_units);
+        spike_T *sparse_probe = hn_pattern_copy(probe, max_units);
+        
+        printf("Probe %zu:\n", n);
+        failures += check_recall(hn_network_from_params(weights, 0., NULL),
+                                 weights, dense_probe, patterns[n], max_units,
+                                 "dense");
+        failures += check_recall(hn_network_from_counts(counts, 0., NULL),
+                                 weights, counts_probe, patterns[n], max_units,
+                                 "counts");
+        failures += check_recall(hn_network_from_sparse(sparse, 0., NULL),
+                                 sparse_dense, sparse_probe, patterns[n],
+                                 max_units, "sparse");
+        /* Fully connected networks well below capacity must retrieve */
+        failures += hn_overlap_frequency(dense_probe, patterns[n],
+                                         max_units) != max_units;
+        
+        free(probe);
+        free(dense_probe);
+        free(counts_probe);
+        free(sparse_probe);
+    }
+    
+    printf("\n%s\n", failures == 0 ? "All tests passed" : "Some tests failed!");
+    
+    MatrixFree(sparse_dense);
+    hn_sparse_weights_free(sparse);
+    MatrixFree(counts.counts);
+    MatrixFree(weights);
+    MatrixFree(patterns);
+    
+    exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
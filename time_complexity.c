@@ -165,16 +165,17 @@ int main(int argc, char **argv)
             hn_fill_rand_pattern(random_initial_state, coding_level, max_units);
             
             /* Create a number of patterns max_patterns (can be constrained
-             * as a function of max_units) and generate weights from them */
+             * as a function of max_units) and generate weights from them
+             * (bitwise: the quickest way, with the very same result) */
             for (m = 0; m < max_patterns; ++m) {
                 hn_fill_rand_pattern(patterns[m], coding_level, max_units);
             }
-            hn_hebb_weights_from_patterns(weights, patterns, max_patterns,
-                                          max_units, REMOVE_SELF_COUPLING);
+            hn_hebb_weights_from_patterns_bitwise(weights, patterns,
+                                                  max_patterns, max_units,
+                                                  REMOVE_SELF_COUPLING);
             
             /* Create network package */
-            net.weights = weights;
-            net.activations = random_initial_state;
+            net = hn_network_from_params(weights, 0., random_initial_state);
             
             /* Test the pattern (and accumulate the number of iterations) */
             clock_start = clock();